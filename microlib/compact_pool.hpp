@@ -0,0 +1,247 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MICROLIB_COMPACT_POOL_HPP__
+#define MICROLIB_COMPACT_POOL_HPP__
+
+#include <cstddef>
+#include <microlib/concurrency.hpp>
+#include <microlib/pool.hpp>
+#include <microlib/util.hpp>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace ulib
+{
+
+    namespace detail
+    {
+
+        // Like pool_element_type, but without the trampoline pointer:
+        // an element is exactly as large as its payload (or a freelist link).
+        template <typename Type>
+        struct compact_pool_element
+        {
+            using type = Type;
+
+            template <typename... Args>
+            void construct(Args &&... args)
+            {
+                new (&storage_) Type(std::forward<Args>(args)...);
+            }
+
+            void destroy()
+            {
+                reinterpret_cast<Type *>(&storage_)->~Type();
+            }
+
+            void set_next_free(compact_pool_element *next_free)
+            {
+                *reinterpret_cast<compact_pool_element **>(&storage_) = next_free;
+            }
+
+            compact_pool_element *get_next_free()
+            {
+                return *reinterpret_cast<compact_pool_element **>(&storage_);
+            }
+
+            Type *get_ptr()
+            {
+                return reinterpret_cast<Type *>(&storage_);
+            }
+
+            const Type *get_ptr() const
+            {
+                return reinterpret_cast<const Type *>(&storage_);
+            }
+
+            using storage_type = typename std::aligned_storage<max(sizeof(Type), sizeof(compact_pool_element *)),
+                                                               max(std::alignment_of<Type>::value,
+                                                                   std::alignment_of<compact_pool_element *>::value)>::type;
+            storage_type storage_;
+        };
+
+    } // namespace detail
+
+    //
+    // Owning pointer into a compact_pool. Since the elements do not know their pool,
+    // the pointer carries it instead: two pointers per handle instead of one pointer per element.
+    //
+    template <typename Pool>
+    struct compact_pool_ptr
+    {
+        using type = typename Pool::type;
+        using element_type = typename Pool::element_type;
+        using pointer_type = element_type *;
+
+        compact_pool_ptr() : pool_(nullptr), the_element_(nullptr)
+        {
+        }
+
+        compact_pool_ptr(const compact_pool_ptr &) = delete;
+        compact_pool_ptr operator=(const compact_pool_ptr &) = delete;
+
+        compact_pool_ptr(Pool *pool, pointer_type the_element) : pool_(pool), the_element_(the_element)
+        {
+        }
+
+        compact_pool_ptr(compact_pool_ptr &&other) : pool_(nullptr), the_element_(nullptr)
+        {
+            std::swap(pool_, other.pool_);
+            std::swap(the_element_, other.the_element_);
+        }
+
+        void clear()
+        {
+            if (the_element_)
+            {
+                auto *buff = the_element_;
+                the_element_ = nullptr;
+                pool_->release(buff);
+            }
+        }
+
+        // Only call this with pointers obtained through release_type() from the very same pool.
+        static compact_pool_ptr from_type_ptr(Pool &pool, type *ptr)
+        {
+            if (!ptr)
+            {
+                return compact_pool_ptr();
+            }
+            else
+            {
+                return compact_pool_ptr(&pool, reinterpret_cast<pointer_type>(ptr));
+            }
+        }
+
+        //
+        // use from_type_ptr to reverse this
+
+        type *release_type()
+        {
+            auto *result = get_payload();
+            the_element_ = nullptr;
+            return result;
+        }
+
+        type *get()
+        {
+            return get_payload();
+        }
+
+        pointer_type release()
+        {
+            auto result = the_element_;
+            the_element_ = nullptr;
+            return result;
+        }
+
+        Pool *pool() const
+        {
+            return pool_;
+        }
+
+        ~compact_pool_ptr()
+        {
+            clear();
+        }
+
+        compact_pool_ptr &operator=(compact_pool_ptr &&other)
+        {
+            clear();
+            std::swap(pool_, other.pool_);
+            std::swap(the_element_, other.the_element_);
+            return *this;
+        }
+
+        type *get_payload()
+        {
+            return the_element_->get_ptr();
+        }
+
+        const type *get_payload() const
+        {
+            return the_element_->get_ptr();
+        }
+
+        explicit operator bool() const
+        {
+            return the_element_ != nullptr;
+        }
+
+        type *operator->()
+        {
+            return the_element_->get_ptr();
+        }
+
+        const type *operator->() const
+        {
+            return the_element_->get_ptr();
+        }
+
+        type &operator*()
+        {
+            return *get_payload();
+        }
+
+        const type &operator*() const
+        {
+            return *get_payload();
+        }
+
+      private:
+        Pool *pool_;
+        pointer_type the_element_;
+    };
+
+    //
+    // Fixed size pool without per-element overhead. Use it instead of pool for small payloads,
+    // where the trampoline pointer would double the element size.
+    // The owning pool is found through the compact_pool_ptr or, given a raw pointer, by address range (contains()).
+    //
+    template <typename Type, size_t Size, typename ConcurrencyTrait = NoConcurrency>
+    struct compact_pool : private detail::pool_freelist<detail::compact_pool_element<Type>, Size, ConcurrencyTrait>
+    {
+        using type = Type;
+        using element_type = detail::compact_pool_element<Type>;
+        using pointer_type = compact_pool_ptr<compact_pool>;
+
+        template <typename... Args>
+        pointer_type make(Args &&... args)
+        {
+            auto *dest = freelist::pop();
+            if (dest)
+            {
+                dest->template construct(std::forward<Args>(args)...);
+                return pointer_type(this, dest);
+            }
+            else
+            {
+                return pointer_type();
+            }
+        }
+
+        // Returns true iff ptr points to an element of this pool.
+        bool contains(const Type *ptr) const
+        {
+            auto *elem = reinterpret_cast<const element_type *>(ptr);
+            return elem >= freelist::elements_ && elem < freelist::elements_ + Size;
+        }
+
+      private:
+        friend pointer_type;
+        using freelist = detail::pool_freelist<element_type, Size, ConcurrencyTrait>;
+
+        void release(element_type *elem)
+        {
+            elem->destroy();
+            freelist::push(elem);
+        }
+    };
+
+} // namespace ulib
+
+#endif
@@ -27,6 +27,18 @@ namespace ulib
         {
         }
     };
+
+    // Selects the atomic implementation of containers supporting it (pool).
+    // Deliberately offers no protect()/unprotect(), so containers relying on a lock fail to compile with it.
+    struct LockFree
+    {
+    };
+
+    // Selects the implementation of containers supporting it (intrusive_ringbuffer) that is
+    // safe for exactly one producer thread and one consumer thread without any lock.
+    struct SingleProducerSingleConsumer
+    {
+    };
     /*
         struct SysLock {
 
@@ -5,6 +5,11 @@
  *      Author: Michael
  */
 
+#ifndef MICROLIB_DETAIL_CALC_HPP__
+#define MICROLIB_DETAIL_CALC_HPP__
+
+#include <cstddef>
+
 namespace ulib
 {
 
@@ -14,9 +19,20 @@ namespace ulib
         template <typename T>
         constexpr bool is_power_of_2(T val)
         {
-            return (val > 1) ? is_power_of_2(val / T(2)) : (val == T(1));
+            return (val > 1) ? (val % T(2) == T(0) && is_power_of_2(val / T(2))) : (val == T(1));
+        }
+
+        // Whether adding batch elements to a heap of size elements is better done by rebuilding the whole heap.
+        // A rebuild (Floyd's method) costs O(size + batch) in any case. Pushing costs O(log) per element
+        // in the worst case (e.g. keys arriving in reverse order), but only O(1) on average for random keys,
+        // so rebuild only when the batch outnumbers the elements already in the heap.
+        constexpr bool heap_rebuild_cheaper(size_t size, size_t batch)
+        {
+            return batch > size;
         }
 
     } // namespace detail
 
 } // namespace ulib
+
+#endif
@@ -0,0 +1,75 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MICROLIB_DETAIL_FLAT_STORAGE_HPP__
+#define MICROLIB_DETAIL_FLAT_STORAGE_HPP__
+
+#include "sorted_search.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <microlib/static_vector.hpp>
+#include <utility>
+
+namespace ulib
+{
+
+    namespace detail
+    {
+
+        //
+        // Shared pieces of static_flat_set and static_flat_map, which keep their keys sorted in a static_vector
+        // of their own (and the mapped values in a parallel one).
+        //
+
+        // Constructs a new element at index, the elements from index on move back by one.
+        // Trivially copyable elements are shifted with a single memmove (std::move_backward).
+        // vec must not be full.
+        template <typename T, size_t Size, typename... Args>
+        void flat_insert_at(static_vector<T, Size> &vec, size_t index, Args &&... args)
+        {
+            vec.emplace_back(std::forward<Args>(args)...);
+            if (index + 1 != size_t(vec.size()))
+            {
+                T val(std::move(vec.back()));
+                std::move_backward(vec.begin() + index, vec.end() - 1, vec.end());
+                vec[index] = std::move(val);
+            }
+        }
+
+        // Removes the element at index, the ones behind move forward by one.
+        template <typename T, size_t Size>
+        void flat_erase_at(static_vector<T, Size> &vec, size_t index)
+        {
+            std::move(vec.begin() + index + 1, vec.end(), vec.begin() + index);
+            vec.pop_back();
+        }
+
+        // index of the first key not ordered before key
+        template <typename K, size_t Size, typename Key, typename Compare>
+        size_t flat_lower_bound(const static_vector<K, Size> &keys, const Key &key, const Compare &compare)
+        {
+            return size_t(sorted_lower_bound(keys.begin(), keys.end(), key, compare) - keys.begin());
+        }
+
+        // index of the first key ordered after key
+        template <typename K, size_t Size, typename Key, typename Compare>
+        size_t flat_upper_bound(const static_vector<K, Size> &keys, const Key &key, const Compare &compare)
+        {
+            return size_t(sorted_upper_bound(keys.begin(), keys.end(), key, compare) - keys.begin());
+        }
+
+        // index of the key equivalent to key, or keys.size()
+        template <typename K, size_t Size, typename Key, typename Compare>
+        size_t flat_find(const static_vector<K, Size> &keys, const Key &key, const Compare &compare)
+        {
+            const size_t index = flat_lower_bound(keys, key, compare);
+            return (index != size_t(keys.size()) && !compare(key, keys[index])) ? index : size_t(keys.size());
+        }
+
+    } // namespace detail
+
+} // namespace ulib
+
+#endif
@@ -0,0 +1,444 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MICROLIB_DETAIL_HEAP_SIMD_HPP__
+#define MICROLIB_DETAIL_HEAP_SIMD_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <microlib/serial_compare.hpp>
+#include <type_traits>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MICROLIB_HEAP_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__SSE4_1__) || defined(__AVX2__)
+#define MICROLIB_HEAP_SSE41
+#include <smmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define MICROLIB_HEAP_AVX2
+#include <immintrin.h>
+#endif
+
+namespace ulib
+{
+
+    namespace detail
+    {
+
+        //
+        // Vectorized selection of the preferred child out of a full group of siblings (d-ary heaps).
+        // heap_child_select<T, Arity, Compare>::enabled tells whether a kernel exists for the key type,
+        // group size, comparator and the instruction sets enabled at compile time;
+        // select(first) then returns the offset of the first minimum (std::less) or maximum (std::greater)
+        // among first[0] ... first[Arity - 1], exactly like a scalar left to right scan would.
+        // Kernels reduce the group to its extreme value with min/max instructions, broadcast it,
+        // and locate it with a compare mask.
+        // Serial number keys are first rebased to the first sibling: (x - first[0]) shifted up so the
+        // counter's top bit lands in the sign bit is the signed distance from first[0], and ordering
+        // those distances is the serial order as long as all siblings lie within half the number space.
+        //
+
+        template <typename Compare, typename T>
+        struct heap_compare_kind
+        {
+            static constexpr bool is_less = std::is_same<Compare, std::less<T>>::value || std::is_same<Compare, std::less<>>::value;
+            static constexpr bool is_greater =
+                std::is_same<Compare, std::greater<T>>::value || std::is_same<Compare, std::greater<>>::value;
+        };
+
+        // Serial number comparators (serial_compare.hpp) of counters with Bits bits stored in T.
+        template <typename Compare, typename T>
+        struct heap_serial_kind
+        {
+            static constexpr bool is_serial = false;
+        };
+
+        template <typename T, size_t Bits>
+        struct heap_serial_kind<serial_less<T, Bits>, T>
+        {
+            static constexpr bool is_serial = true;
+            static constexpr bool is_less = true;
+            static constexpr size_t bits = Bits;
+        };
+
+        template <typename T, size_t Bits>
+        struct heap_serial_kind<serial_greater<T, Bits>, T>
+        {
+            static constexpr bool is_serial = true;
+            static constexpr bool is_less = false;
+            static constexpr size_t bits = Bits;
+        };
+
+        inline size_t first_set_bit(unsigned int mask)
+        {
+            // NaNs never compare equal, fall back to the first child then
+            if (!mask)
+            {
+                return 0;
+            }
+#if defined(_MSC_VER) && !defined(__clang__)
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return index;
+#else
+            return size_t(__builtin_ctz(mask));
+#endif
+        }
+
+        template <typename T, size_t Arity, typename Compare, typename Enable = void>
+        struct heap_child_select
+        {
+            static constexpr bool enabled = false;
+        };
+
+#ifdef MICROLIB_HEAP_SSE2
+
+        // 32 bit integers: unsigned keys are biased into the signed range, which preserves order and equality.
+        template <typename T>
+        struct heap_simd_int32
+        {
+            static constexpr bool is_signed = std::is_signed<T>::value;
+
+            static __m128i load(const T *first)
+            {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first));
+                return is_signed ? v : _mm_xor_si128(v, _mm_set1_epi32(int(0x80000000u)));
+            }
+
+            template <bool Less>
+            static __m128i select(__m128i a, __m128i b)
+            {
+#ifdef MICROLIB_HEAP_SSE41
+                return Less ? _mm_min_epi32(a, b) : _mm_max_epi32(a, b);
+#else
+                const __m128i take_b = Less ? _mm_cmpgt_epi32(a, b) : _mm_cmpgt_epi32(b, a);
+                return _mm_or_si128(_mm_and_si128(take_b, b), _mm_andnot_si128(take_b, a));
+#endif
+            }
+
+            template <bool Less>
+            static size_t select4(const T *first)
+            {
+                const __m128i v = load(first);
+                __m128i m = select<Less>(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+                m = select<Less>(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+                return first_set_bit(unsigned(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, m)))));
+            }
+        };
+
+        template <bool Less>
+        inline __m128 heap_simd_select_ps(__m128 a, __m128 b)
+        {
+            return Less ? _mm_min_ps(a, b) : _mm_max_ps(a, b);
+        }
+
+        template <typename T, typename Compare>
+        struct heap_child_select<T, 4, Compare,
+                                 typename std::enable_if<std::is_integral<T>::value && sizeof(T) == 4 &&
+                                                         (heap_compare_kind<Compare, T>::is_less || heap_compare_kind<Compare, T>::is_greater)>::type>
+        {
+            static constexpr bool enabled = true;
+
+            static size_t select(const T *first)
+            {
+                return heap_simd_int32<T>::template select4<heap_compare_kind<Compare, T>::is_less>(first);
+            }
+        };
+
+        template <typename Compare>
+        struct heap_child_select<float, 4, Compare,
+                                 typename std::enable_if<heap_compare_kind<Compare, float>::is_less ||
+                                                         heap_compare_kind<Compare, float>::is_greater>::type>
+        {
+            static constexpr bool enabled = true;
+            static constexpr bool less = heap_compare_kind<Compare, float>::is_less;
+
+            static size_t select(const float *first)
+            {
+                const __m128 v = _mm_loadu_ps(first);
+                __m128 m = heap_simd_select_ps<less>(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+                m = heap_simd_select_ps<less>(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+                return first_set_bit(unsigned(_mm_movemask_ps(_mm_cmpeq_ps(v, m))));
+            }
+        };
+
+        template <typename T, typename Compare>
+        struct heap_child_select<T, 4, Compare,
+                                 typename std::enable_if<sizeof(T) == 4 && heap_serial_kind<Compare, T>::is_serial>::type>
+        {
+            static constexpr bool enabled = true;
+            static constexpr int shift = int(32 - heap_serial_kind<Compare, T>::bits);
+
+            static size_t select(const T *first)
+            {
+                const __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first));
+                const __m128i v = _mm_slli_epi32(_mm_sub_epi32(raw, _mm_shuffle_epi32(raw, 0)), shift);
+                __m128i m = heap_simd_int32<int32_t>::select<heap_serial_kind<Compare, T>::is_less>(
+                    v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+                m = heap_simd_int32<int32_t>::select<heap_serial_kind<Compare, T>::is_less>(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+                return first_set_bit(unsigned(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, m)))));
+            }
+        };
+
+        // 16 bit counters (e.g. RTP sequence numbers): eight siblings fit into one SSE register.
+        template <typename T, typename Compare>
+        struct heap_child_select<T, 8, Compare,
+                                 typename std::enable_if<sizeof(T) == 2 && heap_serial_kind<Compare, T>::is_serial>::type>
+        {
+            static constexpr bool enabled = true;
+            static constexpr bool less = heap_serial_kind<Compare, T>::is_less;
+            static constexpr int shift = int(16 - heap_serial_kind<Compare, T>::bits);
+
+            static __m128i op(__m128i a, __m128i b)
+            {
+                return less ? _mm_min_epi16(a, b) : _mm_max_epi16(a, b);
+            }
+
+            static size_t select(const T *first)
+            {
+                const __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first));
+                const __m128i v = _mm_slli_epi16(_mm_sub_epi16(raw, _mm_set1_epi16(short(first[0]))), shift);
+                __m128i m = op(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+                m = op(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+                m = op(m, _mm_shufflehi_epi16(_mm_shufflelo_epi16(m, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1)));
+                // two mask bits per lane
+                return first_set_bit(unsigned(_mm_movemask_epi8(_mm_cmpeq_epi16(v, m)))) / 2;
+            }
+        };
+
+#endif // MICROLIB_HEAP_SSE2
+
+#ifdef MICROLIB_HEAP_AVX2
+
+        template <typename T, typename Compare>
+        struct heap_child_select<T, 8, Compare,
+                                 typename std::enable_if<std::is_integral<T>::value && sizeof(T) == 4 &&
+                                                         (heap_compare_kind<Compare, T>::is_less || heap_compare_kind<Compare, T>::is_greater)>::type>
+        {
+            static constexpr bool enabled = true;
+            static constexpr bool less = heap_compare_kind<Compare, T>::is_less;
+
+            static __m256i op(__m256i a, __m256i b)
+            {
+                return std::is_signed<T>::value ? (less ? _mm256_min_epi32(a, b) : _mm256_max_epi32(a, b))
+                                                : (less ? _mm256_min_epu32(a, b) : _mm256_max_epu32(a, b));
+            }
+
+            static size_t select(const T *first)
+            {
+                const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first));
+                __m256i m = op(v, _mm256_permute2x128_si256(v, v, 1));
+                m = op(m, _mm256_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+                m = op(m, _mm256_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+                return first_set_bit(unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, m)))));
+            }
+        };
+
+        template <typename Compare>
+        struct heap_child_select<float, 8, Compare,
+                                 typename std::enable_if<heap_compare_kind<Compare, float>::is_less ||
+                                                         heap_compare_kind<Compare, float>::is_greater>::type>
+        {
+            static constexpr bool enabled = true;
+            static constexpr bool less = heap_compare_kind<Compare, float>::is_less;
+
+            static __m256 op(__m256 a, __m256 b)
+            {
+                return less ? _mm256_min_ps(a, b) : _mm256_max_ps(a, b);
+            }
+
+            static size_t select(const float *first)
+            {
+                const __m256 v = _mm256_loadu_ps(first);
+                __m256 m = op(v, _mm256_permute2f128_ps(v, v, 1));
+                m = op(m, _mm256_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+                m = op(m, _mm256_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+                return first_set_bit(unsigned(_mm256_movemask_ps(_mm256_cmp_ps(v, m, _CMP_EQ_OQ))));
+            }
+        };
+
+        template <typename T, typename Compare>
+        struct heap_child_select<T, 8, Compare,
+                                 typename std::enable_if<sizeof(T) == 4 && heap_serial_kind<Compare, T>::is_serial>::type>
+        {
+            static constexpr bool enabled = true;
+            static constexpr bool less = heap_serial_kind<Compare, T>::is_less;
+            static constexpr int shift = int(32 - heap_serial_kind<Compare, T>::bits);
+
+            static __m256i op(__m256i a, __m256i b)
+            {
+                return less ? _mm256_min_epi32(a, b) : _mm256_max_epi32(a, b);
+            }
+
+            static size_t select(const T *first)
+            {
+                const __m256i raw = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first));
+                const __m256i v = _mm256_slli_epi32(_mm256_sub_epi32(raw, _mm256_set1_epi32(int(first[0]))), shift);
+                __m256i m = op(v, _mm256_permute2x128_si256(v, v, 1));
+                m = op(m, _mm256_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+                m = op(m, _mm256_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+                return first_set_bit(unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, m)))));
+            }
+        };
+
+        // 64 bit integers: AVX2 has no 64 bit min/max, so select through a signed compare
+        // (unsigned keys biased into the signed range first).
+        // Only worth it for 8 children; for 4 the blend latency eats the gain over the scalar scan.
+        template <typename T, bool Less>
+        struct heap_simd_int64
+        {
+            static __m256i load(const T *first)
+            {
+                const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first));
+                return std::is_signed<T>::value ? v : _mm256_xor_si256(v, _mm256_set1_epi64x(int64_t(0x8000000000000000ull)));
+            }
+
+            static __m256i op(__m256i a, __m256i b)
+            {
+                const __m256i take_b = Less ? _mm256_cmpgt_epi64(a, b) : _mm256_cmpgt_epi64(b, a);
+                return _mm256_blendv_epi8(a, b, take_b);
+            }
+
+            // extreme value of v in all four lanes
+            static __m256i reduce(__m256i v)
+            {
+                __m256i m = op(v, _mm256_permute4x64_epi64(v, _MM_SHUFFLE(1, 0, 3, 2)));
+                return op(m, _mm256_permute4x64_epi64(m, _MM_SHUFFLE(2, 3, 0, 1)));
+            }
+
+            static unsigned int mask(__m256i v, __m256i m)
+            {
+                return unsigned(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, m))));
+            }
+        };
+
+        template <typename T, typename Compare>
+        struct heap_child_select<T, 8, Compare,
+                                 typename std::enable_if<std::is_integral<T>::value && sizeof(T) == 8 &&
+                                                         (heap_compare_kind<Compare, T>::is_less || heap_compare_kind<Compare, T>::is_greater)>::type>
+        {
+            static constexpr bool enabled = true;
+            using kernel = heap_simd_int64<T, heap_compare_kind<Compare, T>::is_less>;
+
+            static size_t select(const T *first)
+            {
+                const __m256i lo = kernel::load(first);
+                const __m256i hi = kernel::load(first + 4);
+                const __m256i m = kernel::reduce(kernel::op(lo, hi));
+                return first_set_bit(kernel::mask(lo, m) | (kernel::mask(hi, m) << 4));
+            }
+        };
+
+#endif // MICROLIB_HEAP_AVX2
+
+        //
+        // Vectorized threshold scan for selection (static_topk): heap_threshold_scan<T, Compare>::find(first, last, threshold)
+        // returns the first element x in [first, last) with compare(threshold, x), or last.
+        // Without a kernel for T and Compare, it is a plain loop.
+        //
+
+        template <typename T, typename Compare, typename Enable = void>
+        struct heap_threshold_scan
+        {
+            static constexpr bool enabled = false;
+
+            static const T *find(const T *first, const T *last, const T &threshold, Compare &compare)
+            {
+                while (first != last && !compare(threshold, *first))
+                {
+                    ++first;
+                }
+                return first;
+            }
+        };
+
+#ifdef MICROLIB_HEAP_SSE2
+
+        template <typename T, typename Compare>
+        struct heap_threshold_scan<T, Compare,
+                                   typename std::enable_if<(std::is_integral<T>::value && sizeof(T) == 4) || std::is_same<T, float>::value>::type>
+        {
+            static constexpr bool enabled = heap_compare_kind<Compare, T>::is_less || heap_compare_kind<Compare, T>::is_greater;
+            static constexpr bool less = heap_compare_kind<Compare, T>::is_less;
+
+#ifdef MICROLIB_HEAP_AVX2
+            static constexpr size_t width = 8;
+
+            // bit i set iff first[i] passes the threshold
+            static unsigned int mask(const T *first, const T *threshold)
+            {
+                if constexpr (std::is_same<T, float>::value)
+                {
+                    const __m256 v = _mm256_loadu_ps(first);
+                    const __m256 t = _mm256_broadcast_ss(threshold);
+                    return unsigned(_mm256_movemask_ps(less ? _mm256_cmp_ps(t, v, _CMP_LT_OQ) : _mm256_cmp_ps(v, t, _CMP_LT_OQ)));
+                }
+                else
+                {
+                    const __m256i bias = _mm256_set1_epi32(std::is_signed<T>::value ? 0 : int(0x80000000u));
+                    const __m256i v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(first)), bias);
+                    const __m256i t = _mm256_xor_si256(_mm256_set1_epi32(int(*threshold)), bias);
+                    return unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(less ? _mm256_cmpgt_epi32(v, t) : _mm256_cmpgt_epi32(t, v))));
+                }
+            }
+#else
+            static constexpr size_t width = 4;
+
+            static unsigned int mask(const T *first, const T *threshold)
+            {
+                if constexpr (std::is_same<T, float>::value)
+                {
+                    const __m128 v = _mm_loadu_ps(first);
+                    const __m128 t = _mm_set1_ps(*threshold);
+                    return unsigned(_mm_movemask_ps(less ? _mm_cmplt_ps(t, v) : _mm_cmplt_ps(v, t)));
+                }
+                else
+                {
+                    const __m128i bias = _mm_set1_epi32(std::is_signed<T>::value ? 0 : int(0x80000000u));
+                    const __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(first)), bias);
+                    const __m128i t = _mm_xor_si128(_mm_set1_epi32(int(*threshold)), bias);
+                    return unsigned(_mm_movemask_ps(_mm_castsi128_ps(less ? _mm_cmpgt_epi32(v, t) : _mm_cmpgt_epi32(t, v))));
+                }
+            }
+#endif
+
+            static const T *find(const T *first, const T *last, const T &threshold, Compare &compare)
+            {
+                if constexpr (enabled)
+                {
+                    for (; size_t(last - first) >= width; first += width)
+                    {
+                        const unsigned int bits = mask(first, &threshold);
+                        if (bits)
+                        {
+                            return first + first_set_bit(bits);
+                        }
+                    }
+                }
+                while (first != last && !compare(threshold, *first))
+                {
+                    ++first;
+                }
+                return first;
+            }
+        };
+
+#endif // MICROLIB_HEAP_SSE2
+
+    } // namespace detail
+
+} // namespace ulib
+
+#endif
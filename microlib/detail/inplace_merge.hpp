@@ -0,0 +1,162 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MICROLIB_DETAIL_INPLACE_MERGE_HPP__
+#define MICROLIB_DETAIL_INPLACE_MERGE_HPP__
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+namespace ulib
+{
+
+    namespace detail
+    {
+
+        //
+        // Stable merging and sorting without a temporary buffer from the heap, for the static containers.
+        // std::inplace_merge and std::stable_sort try to get one from operator new first; these take optional
+        // scratch storage from the caller instead, usually the container's unused capacity: raw memory for
+        // scratch_size elements, which is left raw again. If that is less, local_scratch_bytes on the stack are used.
+        // Runs fitting into the scratch are merged in a single pass. Longer ones are split at their medians and the
+        // middle parts exchanged with std::rotate until they fit, O(n log (n / scratch_size)) moves per merge.
+        // The recursion depth is O(log n).
+        //
+
+        constexpr size_t local_scratch_bytes = 512;
+
+        template <typename T>
+        struct local_scratch
+        {
+            static constexpr size_t size = local_scratch_bytes / sizeof(T);
+
+            T *data()
+            {
+                return reinterpret_cast<T *>(&bytes_[0]);
+            }
+
+            alignas(T) unsigned char bytes_[size ? size * sizeof(T) : 1];
+        };
+
+        template <typename Iterator, typename Compare>
+        void merge_runs(Iterator first, Iterator middle, Iterator last, Compare &compare,
+                        typename std::iterator_traits<Iterator>::value_type *scratch, size_t scratch_size)
+        {
+            using value_type = typename std::iterator_traits<Iterator>::value_type;
+
+            while (first != middle && middle != last && compare(*middle, *(middle - 1)))
+            {
+                const auto count1 = middle - first;
+                const auto count2 = last - middle;
+                if (count1 <= count2 && size_t(count1) <= scratch_size)
+                {
+                    // forward merge, the first run moved out of the way
+                    value_type *const scratch_end = std::uninitialized_move(first, middle, scratch);
+                    value_type *from = scratch;
+                    while (from != scratch_end && middle != last)
+                    {
+                        *first++ = compare(*middle, *from) ? std::move(*middle++) : std::move(*from++);
+                    }
+                    std::move(from, scratch_end, first);
+                    std::destroy(scratch, scratch_end);
+                    return;
+                }
+                if (count2 < count1 && size_t(count2) <= scratch_size)
+                {
+                    // backward merge, the second run moved out of the way
+                    value_type *const scratch_end = std::uninitialized_move(middle, last, scratch);
+                    value_type *from = scratch_end;
+                    while (from != scratch && first != middle)
+                    {
+                        *--last = compare(*(from - 1), *(middle - 1)) ? std::move(*--middle) : std::move(*--from);
+                    }
+                    std::move_backward(scratch, from, last);
+                    std::destroy(scratch, scratch_end);
+                    return;
+                }
+                if (count1 + count2 == 2)
+                {
+                    std::iter_swap(first, middle);
+                    return;
+                }
+
+                Iterator cut1;
+                Iterator cut2;
+                if (count1 > count2)
+                {
+                    cut1 = first + count1 / 2;
+                    cut2 = std::lower_bound(middle, last, *cut1, compare);
+                }
+                else
+                {
+                    cut2 = middle + count2 / 2;
+                    cut1 = std::upper_bound(first, middle, *cut2, compare);
+                }
+                const Iterator new_middle = std::rotate(cut1, middle, cut2);
+
+                // recurse into the left part, loop on the right one
+                merge_runs(first, cut1, new_middle, compare, scratch, scratch_size);
+                first = new_middle;
+                middle = cut2;
+            }
+        }
+
+        // Merges the sorted ranges [first, middle) and [middle, last), of equivalent elements those of the
+        // first range come first.
+        template <typename Iterator, typename Compare>
+        void merge_in_place(Iterator first, Iterator middle, Iterator last, Compare &compare,
+                            typename std::iterator_traits<Iterator>::value_type *scratch = nullptr, size_t scratch_size = 0)
+        {
+            local_scratch<typename std::iterator_traits<Iterator>::value_type> local;
+            if (scratch_size < local.size)
+            {
+                scratch = local.data();
+                scratch_size = local.size;
+            }
+            merge_runs(first, middle, last, compare, scratch, scratch_size);
+        }
+
+        // Stable sort: binary insertion sort of short runs, which are then merged pairwise.
+        template <typename Iterator, typename Compare>
+        void stable_sort_in_place(Iterator first, Iterator last, Compare &compare,
+                                  typename std::iterator_traits<Iterator>::value_type *scratch = nullptr, size_t scratch_size = 0)
+        {
+            local_scratch<typename std::iterator_traits<Iterator>::value_type> local;
+            if (scratch_size < local.size)
+            {
+                scratch = local.data();
+                scratch_size = local.size;
+            }
+
+            constexpr size_t run = 16;
+            const size_t count = size_t(last - first);
+
+            for (size_t begin = 0; begin < count; begin += run)
+            {
+                const Iterator run_first = first + begin;
+                const Iterator run_last = first + std::min(count, begin + run);
+                for (Iterator it = run_first + 1; it < run_last; ++it)
+                {
+                    std::rotate(std::upper_bound(run_first, it, *it, compare), it, it + 1);
+                }
+            }
+
+            for (size_t width = run; width < count; width *= 2)
+            {
+                for (size_t begin = 0; begin + width < count; begin += 2 * width)
+                {
+                    merge_runs(first + begin, first + begin + width, first + std::min(count, begin + 2 * width), compare, scratch, scratch_size);
+                }
+            }
+        }
+
+    } // namespace detail
+
+} // namespace ulib
+
+#endif
@@ -0,0 +1,264 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MICROLIB_DETAIL_SORTED_SEARCH_HPP__
+#define MICROLIB_DETAIL_SORTED_SEARCH_HPP__
+
+#include "heap_simd.hpp"
+#include <cstddef>
+#include <type_traits>
+
+namespace ulib
+{
+
+    namespace detail
+    {
+
+        //
+        // Searching sorted contiguous ranges (sorted_static_vector).
+        // The binary search is branchless: each step halves the candidate range with a conditional move
+        // instead of a jump, so the cost is log2(n) dependent loads with nothing to mispredict.
+        // Once the candidates fit into a few SIMD registers (sorted_linear_search<T, Compare>::window),
+        // the search stops halving and counts the elements ordered before the key with vector compares.
+        // A sorted range partitions cleanly, so that count is exactly the offset of the bound.
+        // Kernels exist for 32 bit integers and floats ordered by std::less/std::greater; other types
+        // (and heterogeneous keys) stop at eight elements and add up scalar compares instead.
+        //
+
+        template <typename T, typename Compare, typename Enable = void>
+        struct sorted_linear_search
+        {
+            static constexpr bool enabled = false;
+            static constexpr size_t window = 1;
+        };
+
+#ifdef MICROLIB_HEAP_SSE2
+
+        template <typename T, typename Compare>
+        struct sorted_linear_search<T, Compare,
+                                    typename std::enable_if<((std::is_integral<T>::value && sizeof(T) == 4) || std::is_same<T, float>::value) &&
+                                                            (heap_compare_kind<Compare, T>::is_less ||
+                                                             heap_compare_kind<Compare, T>::is_greater)>::type>
+        {
+            static constexpr bool enabled = true;
+            static constexpr bool less = heap_compare_kind<Compare, T>::is_less;
+
+#ifdef MICROLIB_HEAP_AVX2
+            static constexpr size_t width = 8;
+            using vector = __m256i;
+
+            // lane i all ones iff a > b for a, b = first[i], key (KeyFirst == false) or key, first[i] (KeyFirst == true)
+            template <bool KeyFirst>
+            static vector greater(const T *first, const T &key)
+            {
+                if constexpr (std::is_same<T, float>::value)
+                {
+                    const __m256 v = _mm256_loadu_ps(first);
+                    const __m256 k = _mm256_broadcast_ss(&key);
+                    return _mm256_castps_si256(KeyFirst ? _mm256_cmp_ps(v, k, _CMP_LT_OQ) : _mm256_cmp_ps(k, v, _CMP_LT_OQ));
+                }
+                else
+                {
+                    const __m256i bias = _mm256_set1_epi32(std::is_signed<T>::value ? 0 : int(0x80000000u));
+                    const __m256i v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(first)), bias);
+                    const __m256i k = _mm256_xor_si256(_mm256_set1_epi32(int(key)), bias);
+                    return KeyFirst ? _mm256_cmpgt_epi32(k, v) : _mm256_cmpgt_epi32(v, k);
+                }
+            }
+
+            static vector zero()
+            {
+                return _mm256_setzero_si256();
+            }
+
+            // subtracting all ones lanes counts them
+            static vector count(vector acc, vector mask)
+            {
+                return _mm256_sub_epi32(acc, mask);
+            }
+
+            static size_t sum(vector acc)
+            {
+                __m128i s = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+                s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+                s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+                return size_t(_mm_cvtsi128_si32(s));
+            }
+#else
+            static constexpr size_t width = 4;
+            using vector = __m128i;
+
+            template <bool KeyFirst>
+            static vector greater(const T *first, const T &key)
+            {
+                if constexpr (std::is_same<T, float>::value)
+                {
+                    const __m128 v = _mm_loadu_ps(first);
+                    const __m128 k = _mm_set1_ps(key);
+                    return _mm_castps_si128(KeyFirst ? _mm_cmplt_ps(v, k) : _mm_cmplt_ps(k, v));
+                }
+                else
+                {
+                    const __m128i bias = _mm_set1_epi32(std::is_signed<T>::value ? 0 : int(0x80000000u));
+                    const __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(first)), bias);
+                    const __m128i k = _mm_xor_si128(_mm_set1_epi32(int(key)), bias);
+                    return KeyFirst ? _mm_cmpgt_epi32(k, v) : _mm_cmpgt_epi32(v, k);
+                }
+            }
+
+            static vector zero()
+            {
+                return _mm_setzero_si128();
+            }
+
+            static vector count(vector acc, vector mask)
+            {
+                return _mm_sub_epi32(acc, mask);
+            }
+
+            static size_t sum(vector acc)
+            {
+                acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+                acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+                return size_t(_mm_cvtsi128_si32(acc));
+            }
+#endif
+
+            static constexpr size_t window = 4 * width;
+
+            // number of elements in [first, first + n) with x > key (KeyFirst == false) or key > x
+            template <bool KeyFirst>
+            static size_t count_greater(const T *first, size_t n, const T &key)
+            {
+                vector acc = zero();
+                for (; n >= width; n -= width, first += width)
+                {
+                    acc = count(acc, greater<KeyFirst>(first, key));
+                }
+                size_t result = sum(acc);
+                for (; n > 0; --n, ++first)
+                {
+                    result += KeyFirst ? (key > *first) : (*first > key);
+                }
+                return result;
+            }
+
+            // same for exactly window elements
+            template <bool KeyFirst>
+            static size_t count_greater_window(const T *first, const T &key)
+            {
+                vector acc = zero();
+                for (size_t i = 0; i < window; i += width)
+                {
+                    acc = count(acc, greater<KeyFirst>(first + i, key));
+                }
+                return sum(acc);
+            }
+
+            // number of x with compare(x, key)
+            static size_t count_before(const T *first, size_t n, const T &key)
+            {
+                return n == window ? count_greater_window<less>(first, key) : count_greater<less>(first, n, key);
+            }
+
+            // number of x with !compare(key, x)
+            static size_t count_not_after(const T *first, size_t n, const T &key)
+            {
+                return n - (n == window ? count_greater_window<!less>(first, key) : count_greater<!less>(first, n, key));
+            }
+        };
+
+#endif // MICROLIB_HEAP_SSE2
+
+        // Halves [first, first + n) until at most Window candidates are left.
+        // Returns the first candidate, the partition point of pred lies within [first, first + n] afterwards.
+        template <size_t Window, typename T, typename Pred>
+        const T *sorted_narrow(const T *first, size_t &n, Pred pred)
+        {
+            while (n > Window)
+            {
+                const size_t half = n / 2;
+                first = pred(first[half]) ? first + half : first;
+                n -= half;
+            }
+            return first;
+        }
+
+        // Narrows down to exactly Window candidates (n must be at least Window). The final window may
+        // reach back before the narrowed range, which only adds elements known to be before the partition point.
+        template <size_t Window, typename T, typename Pred>
+        const T *sorted_narrow_window(const T *first, size_t n, Pred pred)
+        {
+            const T *last = first + n;
+            first = sorted_narrow<Window>(first, n, pred);
+            return first + Window <= last ? first : last - Window;
+        }
+
+        // Scalar version: narrows down to a few elements, then adds up pred over them.
+        // The compares are independent of each other, unlike the last binary search steps.
+        template <typename T, typename Pred>
+        const T *sorted_partition_point(const T *first, size_t n, Pred pred)
+        {
+            constexpr size_t window = 8;
+            if (n >= window)
+            {
+                first = sorted_narrow_window<window>(first, n, pred);
+                n = window;
+            }
+            size_t count = 0;
+            for (size_t i = 0; i < n; ++i)
+            {
+                count += pred(first[i]);
+            }
+            return first + count;
+        }
+
+        template <typename T, typename Key, typename Compare>
+        const T *sorted_lower_bound(const T *first, const T *last, const Key &key, const Compare &compare)
+        {
+            size_t n = size_t(last - first);
+            const auto pred = [&](const T &x) { return compare(x, key); };
+            using linear = sorted_linear_search<T, Compare>;
+            if constexpr (linear::enabled && std::is_same<Key, T>::value)
+            {
+                if (n >= linear::window)
+                {
+                    first = sorted_narrow_window<linear::window>(first, n, pred);
+                    n = linear::window;
+                }
+                return first + linear::count_before(first, n, key);
+            }
+            else
+            {
+                return sorted_partition_point(first, n, pred);
+            }
+        }
+
+        template <typename T, typename Key, typename Compare>
+        const T *sorted_upper_bound(const T *first, const T *last, const Key &key, const Compare &compare)
+        {
+            size_t n = size_t(last - first);
+            const auto pred = [&](const T &x) { return !compare(key, x); };
+            using linear = sorted_linear_search<T, Compare>;
+            if constexpr (linear::enabled && std::is_same<Key, T>::value)
+            {
+                if (n >= linear::window)
+                {
+                    first = sorted_narrow_window<linear::window>(first, n, pred);
+                    n = linear::window;
+                }
+                return first + linear::count_not_after(first, n, key);
+            }
+            else
+            {
+                return sorted_partition_point(first, n, pred);
+            }
+        }
+
+    } // namespace detail
+
+} // namespace ulib
+
+#endif
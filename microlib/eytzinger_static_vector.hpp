@@ -0,0 +1,321 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MICROLIB_EYTZINGER_STATIC_VECTOR_HPP__
+#define MICROLIB_EYTZINGER_STATIC_VECTOR_HPP__
+
+#include <functional>
+#include <iterator>
+#include <microlib/sorted_static_vector.hpp>
+#include <microlib/util.hpp>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <xmmintrin.h>
+#endif
+
+namespace ulib
+{
+
+    namespace detail
+    {
+
+        inline void prefetch(const void *addr)
+        {
+#if defined(_MSC_VER) && !defined(__clang__)
+            _mm_prefetch(static_cast<const char *>(addr), _MM_HINT_T0);
+#else
+            __builtin_prefetch(addr);
+#endif
+        }
+
+        // number of trailing one bits of k, k must not have all bits set
+        inline size_t trailing_ones(size_t k)
+        {
+#if defined(_MSC_VER) && !defined(__clang__)
+            unsigned long index;
+#if defined(_WIN64)
+            _BitScanForward64(&index, ~k);
+#else
+            _BitScanForward(&index, ~k);
+#endif
+            return index;
+#else
+            return size_t(__builtin_ctzll(~static_cast<unsigned long long>(k)));
+#endif
+        }
+
+    } // namespace detail
+
+    //
+    // Read-mostly counterpart of sorted_static_vector with static capacity of Size: the elements are stored
+    // in Eytzinger (breadth first) order, i.e. as an implicit binary search tree laid out like a binary heap.
+    // The root is at index 1, the children of k at 2k and 2k + 1, and an in-order walk yields the sorted order.
+    // A lookup descends with k = 2k + compare(element, key), which compiles to a conditional move,
+    // and the descendants a few levels further down share a cache line (the storage is cache line aligned),
+    // so each step prefetches the line it is going to need then. Search costs stay flat where a binary search
+    // over the sorted layout starts missing the cache; tables that fit into the L1 cache are searched just as
+    // fast by sorted_static_vector::lower_bound.
+    // Built once from sorted input; there are no insertions. Conversions to and from sorted_static_vector
+    // are explicit and O(n).
+    // Iterators run over the storage order, only lookups and copy_sorted() see the sorted order.
+    //
+    template <typename T, size_t Size, typename Compare = std::less<T>>
+    class eytzinger_static_vector : private detail::ebo<Compare>
+    {
+        static_assert(Size < (size_t(1) << 31), "Indices must fit into 32 bits.");
+
+      public:
+        using sorted_type = sorted_static_vector<T, Size, Compare>;
+        using iterator = const T *;
+        using const_iterator = const T *;
+        using size_type = size_t;
+
+        eytzinger_static_vector(Compare compare = Compare()) : detail::ebo<Compare>(std::move(compare)), size_(0), levels_(0)
+        {
+        }
+
+        explicit eytzinger_static_vector(const sorted_type &sorted, Compare compare = Compare())
+            : detail::ebo<Compare>(std::move(compare)), size_(0), levels_(0)
+        {
+            assign(sorted);
+        }
+
+        eytzinger_static_vector(const eytzinger_static_vector &) = delete;
+        eytzinger_static_vector &operator=(const eytzinger_static_vector &) = delete;
+
+        ~eytzinger_static_vector()
+        {
+            clear();
+        }
+
+        void assign(const sorted_type &sorted)
+        {
+            assign_sorted(sorted.begin(), sorted.end());
+        }
+
+        // Replaces the contents with [first, last), which must be sorted with respect to Compare.
+        // Takes at most capacity() elements, returns the number taken.
+        template <typename ForwardIterator>
+        size_type assign_sorted(ForwardIterator first, ForwardIterator last)
+        {
+            clear();
+            const size_t count = min(size_t(std::distance(first, last)), Size);
+            for (size_t k = first_in_order(count); k != 0; k = next_in_order(k, count), ++first)
+            {
+                new (slot(k)) T(*first);
+            }
+            size_ = count;
+            levels_ = complete_levels(count);
+            return count;
+        }
+
+        // Writes the elements to out in sorted order, returns the end of the output range.
+        template <typename OutputIterator>
+        OutputIterator copy_sorted(OutputIterator out) const
+        {
+            for (size_t k = first_in_order(size_); k != 0; k = next_in_order(k, size_))
+            {
+                *out++ = element(k);
+            }
+            return out;
+        }
+
+        sorted_type to_sorted() const
+        {
+            sorted_type sorted;
+            for (size_t k = first_in_order(size_); k != 0; k = next_in_order(k, size_))
+            {
+                sorted.emplace_binary(element(k));
+            }
+            return sorted;
+        }
+
+        // Returns the first element (in sorted order) not ordered before key, or end().
+        template <typename Key>
+        const_iterator lower_bound(const Key &key) const
+        {
+            return at(descend([&](const T &x) { return compare()(x, key); }));
+        }
+
+        // Returns the first element (in sorted order) ordered after key, or end().
+        template <typename Key>
+        const_iterator upper_bound(const Key &key) const
+        {
+            return at(descend([&](const T &x) { return !compare()(key, x); }));
+        }
+
+        // Returns the first element (in sorted order) equivalent to key, or end().
+        template <typename Key>
+        const_iterator find(const Key &key) const
+        {
+            const const_iterator it = lower_bound(key);
+            return (it != end() && !compare()(key, *it)) ? it : end();
+        }
+
+        template <typename Key>
+        bool contains(const Key &key) const
+        {
+            return find(key) != end();
+        }
+
+        const_iterator begin() const
+        {
+            return &element(1);
+        }
+
+        const_iterator end() const
+        {
+            return &element(1) + size_;
+        }
+
+        size_type size() const
+        {
+            return size_;
+        }
+
+        bool empty() const
+        {
+            return size_ == 0;
+        }
+
+        constexpr size_type capacity() const
+        {
+            return Size;
+        }
+
+        void clear()
+        {
+            for (size_t k = 1; k <= size_; ++k)
+            {
+                element(k).~T();
+            }
+            size_ = 0;
+            levels_ = 0;
+        }
+
+      private:
+        using element_storage_type = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+        static constexpr size_t cache_line = 64;
+
+        // descendants prefetch_stride * k ... prefetch_stride * k + prefetch_stride - 1 share a cache line
+        static constexpr size_t prefetch_stride = sizeof(T) < cache_line ? cache_line / sizeof(T) : 1;
+
+        // tables fitting into the L1 cache gain nothing from prefetching
+        static constexpr bool prefetching = prefetch_stride > 1 && Size * sizeof(T) > 32 * 1024;
+
+        const Compare &compare() const
+        {
+            return *static_cast<const Compare *>(this);
+        }
+
+        void *slot(size_t k)
+        {
+            return &data_[k];
+        }
+
+        const T &element(size_t k) const
+        {
+            return *reinterpret_cast<const T *>(&data_[k]);
+        }
+
+        T &element(size_t k)
+        {
+            return *reinterpret_cast<T *>(&data_[k]);
+        }
+
+        const_iterator at(size_t k) const
+        {
+            return k ? &element(k) : end();
+        }
+
+        // Walks down while pred holds for the elements passed on the left, i.e. to the partition point
+        // of pred in sorted order. The path taken is recorded in the bits of k: after the last
+        // node where the walk turned left come only right turns, stripping those and the left turn
+        // yields that node, or 0 if it never turned left.
+        // All lookups take the same number of steps through the complete levels, so the loop exit
+        // predicts perfectly; the last, partial level is stepped into with conditional moves only.
+        template <typename Pred>
+        size_t descend(Pred pred) const
+        {
+            if (!size_)
+            {
+                return 0;
+            }
+
+            const char *const base = reinterpret_cast<const char *>(&data_[0]);
+            size_t k = 1;
+            for (size_t level = 0; level < levels_; ++level)
+            {
+                if (prefetching)
+                {
+                    // the descendants of the last levels lie past the end, fall back to k's own line then
+                    const size_t ahead = prefetch_stride * k;
+                    detail::prefetch(base + (ahead <= Size ? ahead : k) * sizeof(element_storage_type));
+                }
+                k = 2 * k + pred(element(k));
+            }
+
+            const bool inside = k <= size_;
+            const size_t next = 2 * k + pred(element(inside ? k : 1));
+            k = inside ? next : k;
+            return k >> (detail::trailing_ones(k) + 1);
+        }
+
+        // number of completely filled levels of a tree of count nodes, floor(log2(count + 1))
+        static size_t complete_levels(size_t count)
+        {
+            size_t levels = 0;
+            while ((size_t(2) << levels) <= count + 1)
+            {
+                ++levels;
+            }
+            return levels;
+        }
+
+        static size_t first_in_order(size_t count)
+        {
+            if (!count)
+            {
+                return 0;
+            }
+            size_t k = 1;
+            while (2 * k <= count)
+            {
+                k = 2 * k;
+            }
+            return k;
+        }
+
+        // in-order successor of k in a tree of count nodes, 0 after the last one
+        static size_t next_in_order(size_t k, size_t count)
+        {
+            if (2 * k + 1 <= count)
+            {
+                k = 2 * k + 1;
+                while (2 * k <= count)
+                {
+                    k = 2 * k;
+                }
+                return k;
+            }
+            return k >> (detail::trailing_ones(k) + 1);
+        }
+
+        // index 0 stays unused, which keeps the index arithmetic plain
+        alignas(cache_line) element_storage_type data_[Size + 1];
+        size_type size_;
+
+        // complete_levels(size_), the number of unconditional search steps
+        size_t levels_;
+    };
+
+} // namespace ulib
+
+#endif
@@ -0,0 +1,339 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MICROLIB_GROWABLE_POOL_HPP__
+#define MICROLIB_GROWABLE_POOL_HPP__
+
+#include <cstddef>
+#include <microlib/concurrency.hpp>
+#include <microlib/pool.hpp>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace ulib
+{
+
+    //
+    // Upstream allocators for growable_pool.
+    // An upstream offers void *allocate(size_t bytes, size_t align), returning nullptr on exhaustion,
+    // and void deallocate(void *ptr, size_t bytes, size_t align).
+    //
+
+    // Slabs from the global heap.
+    struct new_delete_upstream
+    {
+        void *allocate(size_t bytes, size_t align)
+        {
+            return ::operator new(bytes, std::align_val_t(align), std::nothrow);
+        }
+
+        void deallocate(void *ptr, size_t, size_t align)
+        {
+            ::operator delete(ptr, std::align_val_t(align));
+        }
+    };
+
+    // Slabs from a static arena of Blocks blocks of BlockSize bytes each.
+    // Use growable_pool_slab_size<Type, SlabSize> for BlockSize.
+    template <size_t BlockSize, size_t Blocks, size_t Align = alignof(std::max_align_t)>
+    struct static_block_arena
+    {
+        static_block_arena() : first_free_(nullptr), unused_(0)
+        {
+        }
+
+        void *allocate(size_t bytes, size_t align)
+        {
+            if (bytes > BlockSize || align > Align)
+            {
+                return nullptr;
+            }
+
+            if (first_free_)
+            {
+                auto *result = first_free_;
+                first_free_ = *reinterpret_cast<block_type **>(result);
+                return result;
+            }
+            else if (unused_ != Blocks)
+            {
+                return &blocks_[unused_++];
+            }
+            else
+            {
+                return nullptr;
+            }
+        }
+
+        void deallocate(void *ptr, size_t, size_t)
+        {
+            *reinterpret_cast<block_type **>(ptr) = first_free_;
+            first_free_ = static_cast<block_type *>(ptr);
+        }
+
+      private:
+        using block_type = typename std::aligned_storage<max(BlockSize, sizeof(void *)), Align>::type;
+
+        block_type *first_free_;
+        size_t unused_;
+        block_type blocks_[Blocks];
+    };
+
+    namespace detail
+    {
+
+        template <typename Type, size_t SlabSize>
+        struct pool_slab
+        {
+            using element_type = pool_element_type<Type>;
+
+            void *owner_;
+            pool_slab *prev_;
+            pool_slab *next_;
+
+            // free elements are either on the freelist or were never handed out yet (index >= unused_)
+            element_type *first_free_;
+            size_t unused_;
+            size_t used_;
+
+            trampoline<Type> trampoline_;
+            element_type elements_[SlabSize];
+        };
+
+        // Intrusive doubly linked list of slabs.
+        template <typename Slab>
+        struct slab_list
+        {
+            slab_list() : front_(nullptr)
+            {
+            }
+
+            void push_front(Slab *slab)
+            {
+                slab->prev_ = nullptr;
+                slab->next_ = front_;
+                if (front_)
+                {
+                    front_->prev_ = slab;
+                }
+                front_ = slab;
+            }
+
+            void erase(Slab *slab)
+            {
+                if (slab->prev_)
+                {
+                    slab->prev_->next_ = slab->next_;
+                }
+                else
+                {
+                    front_ = slab->next_;
+                }
+
+                if (slab->next_)
+                {
+                    slab->next_->prev_ = slab->prev_;
+                }
+            }
+
+            Slab *front_;
+        };
+
+    } // namespace detail
+
+    // Number of bytes one slab of a growable_pool<Type, SlabSize, ...> requests from its upstream.
+    template <typename Type, size_t SlabSize>
+    constexpr size_t growable_pool_slab_size = sizeof(detail::pool_slab<Type, SlabSize>);
+
+    //
+    // Pool handing out pool_ptr which grows by slabs of SlabSize elements taken from Upstream.
+    // Every slab has its own trampoline, so freeing an element finds its slab in O(1).
+    // Slabs with free elements are kept on a list, make() always takes from its front.
+    // With ReturnEmptySlabs, a slab that becomes completely free is handed back to Upstream,
+    // unless it is the only one with free elements left (to avoid thrashing at the boundary).
+    //
+    template <typename Type, size_t SlabSize, typename Upstream = new_delete_upstream, bool ReturnEmptySlabs = false,
+              typename ConcurrencyTrait = NoConcurrency>
+    struct growable_pool : public ConcurrencyTrait
+    {
+        using element_type = detail::pool_element_type<Type>;
+        using pointer_type = pool_ptr<Type>;
+
+        struct statistics
+        {
+            size_t in_use;
+            size_t in_use_high_water;
+            size_t slabs;
+            size_t slabs_high_water;
+            size_t bytes_high_water;
+        };
+
+        growable_pool(Upstream upstream = Upstream())
+            : upstream_(std::move(upstream)), in_use_(0), in_use_high_water_(0), slabs_(0), slabs_high_water_(0)
+        {
+        }
+
+        growable_pool(const growable_pool &) = delete;
+        growable_pool &operator=(const growable_pool &) = delete;
+
+        // All elements must have been freed before.
+        ~growable_pool()
+        {
+            release_all(partial_);
+            release_all(full_);
+        }
+
+        template <typename... Args>
+        pointer_type make(Args &&... args)
+        {
+            auto *dest = acquire();
+            if (dest)
+            {
+                dest->template construct(std::forward<Args>(args)...);
+                return pointer_type(dest);
+            }
+            else
+            {
+                return pointer_type();
+            }
+        }
+
+        statistics stats()
+        {
+            ConcurrencyTrait::protect();
+            statistics result = {in_use_, in_use_high_water_, slabs_, slabs_high_water_, slabs_high_water_ * sizeof(slab_type)};
+            ConcurrencyTrait::unprotect();
+            return result;
+        }
+
+        Upstream &upstream()
+        {
+            return upstream_;
+        }
+
+      private:
+        using slab_type = detail::pool_slab<Type, SlabSize>;
+
+        static void free_func(element_type *elem, void *arg)
+        {
+            auto *slab = static_cast<slab_type *>(arg);
+            static_cast<growable_pool *>(slab->owner_)->release(slab, elem);
+        }
+
+        slab_type *grow()
+        {
+            void *mem = upstream_.allocate(sizeof(slab_type), alignof(slab_type));
+            if (!mem)
+            {
+                return nullptr;
+            }
+
+            // elements are constructed lazily, so this is O(1)
+            auto *slab = new (mem) slab_type;
+            slab->owner_ = this;
+            slab->first_free_ = nullptr;
+            slab->unused_ = 0;
+            slab->used_ = 0;
+            slab->trampoline_.pool = slab;
+            slab->trampoline_.func = free_func;
+
+            partial_.push_front(slab);
+            if (++slabs_ > slabs_high_water_)
+            {
+                slabs_high_water_ = slabs_;
+            }
+            return slab;
+        }
+
+        element_type *acquire()
+        {
+            element_type *result = nullptr;
+
+            ConcurrencyTrait::protect();
+            slab_type *slab = partial_.front_ ? partial_.front_ : grow();
+            if (slab)
+            {
+                if (slab->first_free_)
+                {
+                    result = slab->first_free_;
+                    slab->first_free_ = result->get_next_free();
+                }
+                else
+                {
+                    result = &slab->elements_[slab->unused_++];
+                    result->trampoline_ = &slab->trampoline_;
+                }
+
+                if (++slab->used_ == SlabSize)
+                {
+                    partial_.erase(slab);
+                    full_.push_front(slab);
+                }
+
+                if (++in_use_ > in_use_high_water_)
+                {
+                    in_use_high_water_ = in_use_;
+                }
+            }
+            ConcurrencyTrait::unprotect();
+
+            return result;
+        }
+
+        void release(slab_type *slab, element_type *elem)
+        {
+            elem->destroy();
+
+            ConcurrencyTrait::protect();
+            elem->set_next_free(slab->first_free_);
+            slab->first_free_ = elem;
+            --in_use_;
+
+            // a slab of one element goes from full to empty at once, so both may apply
+            if (slab->used_-- == SlabSize)
+            {
+                full_.erase(slab);
+                partial_.push_front(slab);
+            }
+            if (ReturnEmptySlabs && slab->used_ == 0 && (slab->prev_ || slab->next_))
+            {
+                partial_.erase(slab);
+                free_slab(slab);
+            }
+            ConcurrencyTrait::unprotect();
+        }
+
+        void free_slab(slab_type *slab)
+        {
+            slab->~slab_type();
+            upstream_.deallocate(slab, sizeof(slab_type), alignof(slab_type));
+            --slabs_;
+        }
+
+        void release_all(detail::slab_list<slab_type> &list)
+        {
+            while (list.front_)
+            {
+                auto *slab = list.front_;
+                list.erase(slab);
+                free_slab(slab);
+            }
+        }
+
+      private:
+        Upstream upstream_;
+        detail::slab_list<slab_type> partial_;
+        detail::slab_list<slab_type> full_;
+
+        size_t in_use_;
+        size_t in_use_high_water_;
+        size_t slabs_;
+        size_t slabs_high_water_;
+    };
+
+} // namespace ulib
+
+#endif
@@ -8,6 +8,7 @@
 
 #include <cstddef>
 #include <microlib/concurrency.hpp>
+#include <microlib/pool_statistics.hpp>
 #include <new>
 #include <utility>
 
@@ -28,12 +29,17 @@ namespace ulib
 
     /*
      * Note also that this is basically only a static store using an intrusive stack as a freelist
+     * Pass pool_statistics as Statistics to track usage, see statistics().
      *
      */
 
-    template <typename Type, unsigned int Size, typename ConcurrencyTrait = NoConcurrency>
-    struct intrusive_pool : public ConcurrencyTrait
+    template <typename Type, unsigned int Size, typename ConcurrencyTrait = NoConcurrency, typename Statistics = no_pool_statistics>
+    struct intrusive_pool : public ConcurrencyTrait, private detail::pool_statistics_type<Statistics, ConcurrencyTrait>
     {
+      private:
+        using statistics_type = detail::pool_statistics_type<Statistics, ConcurrencyTrait>;
+
+      public:
         intrusive_pool()
         {
             for (unsigned int i = 0; i < Size - 1; ++i)
@@ -54,6 +60,7 @@ namespace ulib
             ConcurrencyTrait::protect();
             intrusive_pool_set_next_free(ptr, first_free);
             first_free = ptr;
+            statistics_type::on_release(1);
 #ifdef DEBUG_POOLS
             ++free_count;
             check_integrity();
@@ -74,15 +81,89 @@ namespace ulib
                 --free_count;
                 check_integrity();
 #endif
+                statistics_type::on_acquire(1);
                 ConcurrencyTrait::unprotect();
                 return ret;
             }
             else
             {
+                if (statistics_type::enabled)
+                {
+                    ConcurrencyTrait::protect();
+                    statistics_type::on_failure();
+                    ConcurrencyTrait::unprotect();
+                }
                 return nullptr;
             }
         }
 
+        // Acquires up to n elements into out with a single protect()/unprotect() pair.
+        // Returns the number of elements acquired.
+        unsigned int acquire_n(Type **out, unsigned int n)
+        {
+            unsigned int count = 0;
+            ConcurrencyTrait::protect();
+            while (count < n && first_free)
+            {
+                out[count++] = first_free;
+                first_free = intrusive_pool_get_next_free(first_free);
+
+#ifdef DEBUG_POOLS
+                intrusive_pool_set_next_free(out[count - 1], nullptr);
+                --free_count;
+#endif
+            }
+#ifdef DEBUG_POOLS
+            check_integrity();
+#endif
+            statistics_type::on_acquire(count);
+            if (count != n)
+            {
+                statistics_type::on_failure();
+            }
+            ConcurrencyTrait::unprotect();
+            return count;
+        }
+
+        // Releases n elements with a single protect()/unprotect() pair.
+        void release_n(Type *const *in, unsigned int n)
+        {
+            if (!n)
+            {
+                return;
+            }
+
+            for (unsigned int i = 0; i < n - 1; ++i)
+            {
+                intrusive_pool_set_next_free(in[i], in[i + 1]);
+            }
+            splice(in[0], in[n - 1], n);
+        }
+
+        // Releases a chain of elements from first to last which are already linked
+        // through intrusive_pool_set_next_free. The link of last is overwritten.
+        void release_chain(Type *first, Type *last)
+        {
+            unsigned int count = 1;
+            if (statistics_type::enabled)
+            {
+                for (Type *curr = first; curr != last; curr = intrusive_pool_get_next_free(curr))
+                {
+                    ++count;
+                }
+            }
+            splice(first, last, count);
+        }
+
+        // Only available with an enabled Statistics policy.
+        pool_statistics_snapshot statistics()
+        {
+            ConcurrencyTrait::protect();
+            const pool_statistics_snapshot result = statistics_type::snapshot();
+            ConcurrencyTrait::unprotect();
+            return result;
+        }
+
         Type *begin()
         {
             return elements;
@@ -93,6 +174,26 @@ namespace ulib
             return elements + Size;
         }
 
+      private:
+        // count is only used for the statistics
+        void splice(Type *first, Type *last, unsigned int count)
+        {
+            ConcurrencyTrait::protect();
+            intrusive_pool_set_next_free(last, first_free);
+            first_free = first;
+            statistics_type::on_release(count);
+#ifdef DEBUG_POOLS
+            for (Type *curr = first; curr != last; curr = intrusive_pool_get_next_free(curr))
+            {
+                ++free_count;
+            }
+            ++free_count;
+            check_integrity();
+#endif
+            ConcurrencyTrait::unprotect();
+        }
+
+      public:
 #ifdef DEBUG_POOLS
         bool check_is_element(Type *ptr)
         {
@@ -6,6 +6,7 @@
 #ifndef MICROLIB_INTRUSIVE_RING_HPP_
 #define MICROLIB_INTRUSIVE_RING_HPP_
 
+#include <atomic>
 #include <cstddef>
 #include <microlib/concurrency.hpp>
 
@@ -115,6 +116,136 @@ namespace ulib
         Type elements[Size];
     };
 
+    //
+    // Wait-free single producer / single consumer ring.
+    // The producer owns idle_front()/commit(), the consumer owns committed_front()/release().
+    // Cursors are counters modulo 2 * Size (so a full ring can be told apart from an empty one without
+    // wasting a slot) and live on separate cache lines together with a cached copy of the opposite
+    // cursor, which is only reloaded when the ring looks full (producer) or empty (consumer).
+    // Type needs no intrusive link in this mode.
+    //
+    template <typename Type, unsigned int Size>
+    struct intrusive_ringbuffer<Type, Size, SingleProducerSingleConsumer>
+    {
+        intrusive_ringbuffer()
+        {
+            producer_.tail_.store(0, std::memory_order_relaxed);
+            producer_.cached_head_ = 0;
+            consumer_.head_.store(0, std::memory_order_relaxed);
+            consumer_.cached_tail_ = 0;
+        }
+
+        // Producer: Commits the current idle front
+        void commit()
+        {
+            producer_.tail_.store(next(producer_.tail_.load(std::memory_order_relaxed)), std::memory_order_release);
+        }
+
+        // Consumer: Releases the current commit front
+        void release()
+        {
+            consumer_.head_.store(next(consumer_.head_.load(std::memory_order_relaxed)), std::memory_order_release);
+        }
+
+        // Producer: true iff there is no idle element
+        bool full()
+        {
+            return idle_front() == nullptr;
+        }
+
+        // Consumer: true iff there is no committed element
+        bool empty()
+        {
+            return committed_front() == nullptr;
+        }
+
+        // Producer: returns the element to fill next or nullptr if the ring is full.
+        Type *idle_front()
+        {
+            const unsigned int tail = producer_.tail_.load(std::memory_order_relaxed);
+            if (distance(producer_.cached_head_, tail) == Size)
+            {
+                producer_.cached_head_ = consumer_.head_.load(std::memory_order_acquire);
+                if (distance(producer_.cached_head_, tail) == Size)
+                {
+                    return nullptr;
+                }
+            }
+            return elements + slot(tail);
+        }
+
+        // Consumer: returns the oldest committed element or nullptr if the ring is empty.
+        Type *committed_front()
+        {
+            const unsigned int head = consumer_.head_.load(std::memory_order_relaxed);
+            if (consumer_.cached_tail_ == head)
+            {
+                consumer_.cached_tail_ = producer_.tail_.load(std::memory_order_acquire);
+                if (consumer_.cached_tail_ == head)
+                {
+                    return nullptr;
+                }
+            }
+            return elements + slot(head);
+        }
+
+        Type *begin()
+        {
+            return elements;
+        }
+
+        Type *end()
+        {
+            return elements + Size;
+        }
+
+        bool check_is_element(Type *ptr) const
+        {
+            for (size_t i = 0; i < Size; ++i)
+            {
+                if (elements + i == ptr)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+      private:
+        static unsigned int next(unsigned int cursor)
+        {
+            return (cursor + 1 == 2 * Size) ? 0 : cursor + 1;
+        }
+
+        static unsigned int slot(unsigned int cursor)
+        {
+            return (cursor < Size) ? cursor : cursor - Size;
+        }
+
+        static unsigned int distance(unsigned int head, unsigned int tail)
+        {
+            return (tail >= head) ? tail - head : tail + 2 * Size - head;
+        }
+
+        struct alignas(64) producer_cursor
+        {
+            std::atomic<unsigned int> tail_;
+            unsigned int cached_head_;
+        };
+
+        struct alignas(64) consumer_cursor
+        {
+            std::atomic<unsigned int> head_;
+            unsigned int cached_tail_;
+        };
+
+        producer_cursor producer_;
+        consumer_cursor consumer_;
+
+      public:
+        Type elements[Size];
+    };
+
 } // namespace ulib
 
 #endif /* INTRUSIVE_RING_HPP_ */
@@ -0,0 +1,235 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MICROLIB_MAGAZINE_POOL_HPP__
+#define MICROLIB_MAGAZINE_POOL_HPP__
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <microlib/pool.hpp>
+#include <utility>
+
+namespace ulib
+{
+
+    //
+    // Pool with a per-thread cache ("magazine") of free elements in front of the shared freelist.
+    // make() and pool_ptr::clear() only work on the calling thread's magazine and touch the shared
+    // freelist once per MagazineSize / 2 elements, when the magazine runs empty or full.
+    //
+    // Caveats:
+    //  - A thread keeps magazines for up to magazines_per_thread instances of the same magazine_pool type,
+    //    further instances used on that thread go to the shared freelist directly.
+    //  - Up to MagazineSize elements per thread may sit in a magazine, so make() can fail on
+    //    one thread while another thread still caches free elements.
+    //  - Magazines are returned to the pool when their thread exits (or on flush()), so the
+    //    pool must outlive all threads that used it, or they must flush() first. The destructor takes
+    //    back the calling thread's magazine and calls std::terminate() if another thread still holds one:
+    //    that thread would hand elements to freed memory, or to a new pool at the same address.
+    //
+    template <typename Type, size_t Size, size_t MagazineSize = 32, typename ConcurrencyTrait = LockFree>
+    struct magazine_pool : private detail::pool_freelist<detail::pool_element_type<Type>, Size, ConcurrencyTrait>
+    {
+        static_assert(MagazineSize >= 2 && MagazineSize % 2 == 0, "MagazineSize must be even and at least 2.");
+
+        using element_type = detail::pool_element_type<Type>;
+        using pointer_type = pool_ptr<Type>;
+
+        static constexpr size_t magazines_per_thread = 4;
+
+        magazine_pool() : bound_(0)
+        {
+            trampoline_.func = free_func;
+            trampoline_.pool = this;
+
+            for (size_t i = 0; i < Size; ++i)
+            {
+                freelist::elements_[i].trampoline_ = &trampoline_;
+            }
+        }
+
+        magazine_pool(const magazine_pool &) = delete;
+        magazine_pool &operator=(const magazine_pool &) = delete;
+
+        ~magazine_pool()
+        {
+            flush();
+            if (bound_.load(std::memory_order_acquire) != 0)
+            {
+                // another thread still caches elements of this pool
+                std::terminate();
+            }
+        }
+
+        static void free_func(element_type *elem, void *arg)
+        {
+            reinterpret_cast<magazine_pool *>(arg)->release(elem);
+        }
+
+        template <typename... Args>
+        pointer_type make(Args &&... args)
+        {
+            auto *dest = acquire();
+            if (dest)
+            {
+                dest->template construct(std::forward<Args>(args)...);
+                return pointer_type(dest);
+            }
+            else
+            {
+                return pointer_type();
+            }
+        }
+
+        // Returns the calling thread's cached elements to the shared freelist and releases its magazine.
+        void flush()
+        {
+            for (magazine &mag : magazines_.magazines_)
+            {
+                if (mag.owner_ == this)
+                {
+                    mag.unbind();
+                }
+            }
+        }
+
+      private:
+        using freelist = detail::pool_freelist<element_type, Size, ConcurrencyTrait>;
+
+        static constexpr size_t batch_size = MagazineSize / 2;
+
+        struct magazine
+        {
+            // hands the cached elements back to the owner, the magazine is free for another instance afterwards
+            void unbind()
+            {
+                owner_->freelist::push_n(slots_, count_);
+                owner_->bound_.fetch_sub(1, std::memory_order_release);
+                owner_ = nullptr;
+                count_ = 0;
+            }
+
+            magazine_pool *owner_;
+            size_t count_;
+            element_type *slots_[MagazineSize];
+        };
+
+        // the magazines of one thread, keyed by the owning instance
+        struct magazine_table
+        {
+            magazine_table()
+            {
+                for (magazine &mag : magazines_)
+                {
+                    mag.owner_ = nullptr;
+                    mag.count_ = 0;
+                }
+            }
+
+            ~magazine_table()
+            {
+                for (magazine &mag : magazines_)
+                {
+                    if (mag.owner_)
+                    {
+                        mag.unbind();
+                    }
+                }
+            }
+
+            magazine magazines_[magazines_per_thread];
+        };
+
+        // Returns the calling thread's magazine for this instance, binding a free one on first use,
+        // or nullptr if the thread's magazines are all bound to other instances.
+        magazine *bind()
+        {
+            magazine *unused = nullptr;
+            for (magazine &mag : magazines_.magazines_)
+            {
+                if (mag.owner_ == this)
+                {
+                    return &mag;
+                }
+                if (!mag.owner_ && !unused)
+                {
+                    unused = &mag;
+                }
+            }
+
+            if (unused)
+            {
+                unused->owner_ = this;
+                bound_.fetch_add(1, std::memory_order_relaxed);
+            }
+            return unused;
+        }
+
+        element_type *acquire()
+        {
+            magazine *const bound = bind();
+            if (!bound)
+            {
+                return freelist::pop();
+            }
+
+            magazine &mag = *bound;
+
+            if (!mag.count_)
+            {
+                mag.count_ = freelist::pop_n(mag.slots_, batch_size);
+                if (!mag.count_)
+                {
+                    return nullptr;
+                }
+            }
+
+            return mag.slots_[--mag.count_];
+        }
+
+        void release(element_type *elem)
+        {
+            elem->destroy();
+
+            magazine *const bound = bind();
+            if (!bound)
+            {
+                freelist::push(elem);
+                return;
+            }
+
+            magazine &mag = *bound;
+
+            if (mag.count_ == MagazineSize)
+            {
+                // hand back the coldest half, keep the recently freed ones
+                freelist::push_n(mag.slots_, batch_size);
+                for (size_t i = 0; i < MagazineSize - batch_size; ++i)
+                {
+                    mag.slots_[i] = mag.slots_[i + batch_size];
+                }
+                mag.count_ -= batch_size;
+            }
+
+            mag.slots_[mag.count_++] = elem;
+        }
+
+      private:
+        detail::trampoline<Type> trampoline_;
+
+        // number of magazines bound to this instance, across all threads
+        std::atomic<size_t> bound_;
+
+        static thread_local magazine_table magazines_;
+    };
+
+    template <typename Type, size_t Size, size_t MagazineSize, typename ConcurrencyTrait>
+    thread_local typename magazine_pool<Type, Size, MagazineSize, ConcurrencyTrait>::magazine_table
+        magazine_pool<Type, Size, MagazineSize, ConcurrencyTrait>::magazines_;
+
+} // namespace ulib
+
+#endif
@@ -0,0 +1,296 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MICROLIB_MONOTONIC_ARENA_HPP__
+#define MICROLIB_MONOTONIC_ARENA_HPP__
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory_resource>
+#include <microlib/string.hpp>
+#include <microlib/util.hpp>
+
+namespace ulib
+{
+
+    //
+    // Bump allocator over a caller supplied buffer, for scratch memory that dies all at once.
+    // allocate() only moves a cursor; there is no per-allocation deallocate.
+    // Memory is handed back in bulk with rewind() to a mark() taken earlier, or with reset().
+    // The most recent allocation can be grown in place (extend()).
+    //
+    class monotonic_arena
+    {
+      public:
+        // Position of the cursor, see mark() and rewind().
+        using marker = size_t;
+
+        monotonic_arena(void *buffer, size_t size) : begin_(static_cast<unsigned char *>(buffer)), size_(size), used_(0), last_(0)
+        {
+        }
+
+        template <size_t Size>
+        explicit monotonic_arena(unsigned char (&buffer)[Size]) : monotonic_arena(buffer, Size)
+        {
+        }
+
+        monotonic_arena(const monotonic_arena &) = delete;
+        monotonic_arena &operator=(const monotonic_arena &) = delete;
+
+        // Returns nullptr if the rest of the buffer is too small. align must be a power of 2.
+        void *allocate(size_t bytes, size_t align = alignof(std::max_align_t))
+        {
+            const uintptr_t cursor = reinterpret_cast<uintptr_t>(begin_) + used_;
+            const size_t offset = used_ + ((align - cursor % align) & (align - 1));
+            if (offset > size_ || bytes > size_ - offset)
+            {
+                return nullptr;
+            }
+
+            last_ = offset;
+            used_ = offset + bytes;
+            return begin_ + offset;
+        }
+
+        template <typename Type>
+        Type *allocate_array(size_t count)
+        {
+            if (count > size_t(-1) / sizeof(Type))
+            {
+                return nullptr;
+            }
+            return static_cast<Type *>(allocate(count * sizeof(Type), alignof(Type)));
+        }
+
+        // Resizes the most recent allocation ptr to new_size bytes without moving it.
+        // Returns false if ptr is not the most recent allocation or the buffer is too small.
+        bool extend(void *ptr, size_t new_size)
+        {
+            if (ptr != begin_ + last_ || used_ < last_ || new_size > size_ - last_)
+            {
+                return false;
+            }
+
+            used_ = last_ + new_size;
+            return true;
+        }
+
+        marker mark() const
+        {
+            return used_;
+        }
+
+        // Frees everything allocated after m was taken.
+        void rewind(marker m)
+        {
+            used_ = m;
+        }
+
+        void reset()
+        {
+            used_ = 0;
+        }
+
+        bool owns(const void *ptr) const
+        {
+            auto *p = static_cast<const unsigned char *>(ptr);
+            return p >= begin_ && p < begin_ + size_;
+        }
+
+        size_t used() const
+        {
+            return used_;
+        }
+
+        size_t available() const
+        {
+            return size_ - used_;
+        }
+
+        size_t capacity() const
+        {
+            return size_;
+        }
+
+      private:
+        unsigned char *begin_;
+        size_t size_;
+        size_t used_;
+
+        // offset of the most recent allocation; only valid while used_ >= last_
+        size_t last_;
+    };
+
+    //
+    // Rewinds the arena to where it was at construction when leaving the scope.
+    //
+    class arena_scope
+    {
+      public:
+        explicit arena_scope(monotonic_arena &arena) : arena_(arena), mark_(arena.mark())
+        {
+        }
+
+        arena_scope(const arena_scope &) = delete;
+        arena_scope &operator=(const arena_scope &) = delete;
+
+        ~arena_scope()
+        {
+            arena_.rewind(mark_);
+        }
+
+      private:
+        monotonic_arena &arena_;
+        monotonic_arena::marker mark_;
+    };
+
+    //
+    // std::pmr adaptor. Deallocation is a no-op for arena memory, use mark()/rewind() instead.
+    // Requests the arena cannot serve go to the upstream resource, which throws std::bad_alloc by default.
+    //
+    class arena_resource : public std::pmr::memory_resource
+    {
+      public:
+        arena_resource(monotonic_arena &arena, std::pmr::memory_resource *upstream = std::pmr::null_memory_resource())
+            : arena_(arena), upstream_(upstream)
+        {
+        }
+
+        monotonic_arena &arena() const
+        {
+            return arena_;
+        }
+
+      private:
+        void *do_allocate(size_t bytes, size_t align) override
+        {
+            void *result = arena_.allocate(bytes, align);
+            return result ? result : upstream_->allocate(bytes, align);
+        }
+
+        void do_deallocate(void *ptr, size_t bytes, size_t align) override
+        {
+            if (!arena_.owns(ptr))
+            {
+                upstream_->deallocate(ptr, bytes, align);
+            }
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+        {
+            return this == &other;
+        }
+
+        monotonic_arena &arena_;
+        std::pmr::memory_resource *upstream_;
+    };
+
+    //
+    // ulib::string taking its storage from a monotonic_arena and growing on demand.
+    // As long as the string holds the most recent allocation of the arena it grows in place,
+    // otherwise it moves to a new block twice as large (the old one stays in the arena until rewound).
+    // Appending silently truncates, like ulib::string, once the arena runs out.
+    //
+    class arena_string : public string
+    {
+      public:
+        explicit arena_string(monotonic_arena &arena, size_t initial_capacity = 32) : string(nullptr, 0), arena_(arena)
+        {
+            data_ = static_cast<char *>(arena_.allocate(initial_capacity, 1));
+            max_size_ = data_ ? initial_capacity : 0;
+        }
+
+        arena_string(const arena_string &) = delete;
+        arena_string &operator=(const arena_string &) = delete;
+
+        // Formats into the free space first and only on overflow grows and formats again.
+        int printf(const char *fmt, ...)
+        {
+            va_list args;
+            va_list retry;
+            va_start(args, fmt);
+            va_copy(retry, args);
+
+            const size_t before = size_;
+            int ret = max_size_ ? string::vprintf(fmt, args) : vsnprintf(nullptr, 0, fmt, args);
+            if (ret > 0 && size_ == before && reserve(size_t(ret)))
+            {
+                ret = string::vprintf(fmt, retry);
+            }
+
+            va_end(retry);
+            va_end(args);
+            return ret;
+        }
+
+        arena_string &operator+=(const string &other)
+        {
+            if (reserve(other.size()))
+            {
+                string::operator+=(other);
+            }
+            return *this;
+        }
+
+        arena_string &operator+=(const const_string &other)
+        {
+            if (reserve(other.size()))
+            {
+                memcpy(data_ + size_, other.c_string(), other.size());
+                size_ += other.size();
+            }
+            return *this;
+        }
+
+        // Makes room for extra more characters. Returns false if the arena is exhausted.
+        bool reserve(size_t extra)
+        {
+            if (max_size_ != 0 && available() >= extra)
+            {
+                return true;
+            }
+
+            const size_t needed = size_ + extra + 1;
+            if (data_ && arena_.extend(data_, max(needed, max_size_ * 2)))
+            {
+                max_size_ = max(needed, max_size_ * 2);
+                return true;
+            }
+            if (data_ && arena_.extend(data_, needed))
+            {
+                max_size_ = needed;
+                return true;
+            }
+
+            const size_t capacity = max(needed, max_size_ * 2);
+            auto *grown = static_cast<char *>(arena_.allocate(capacity, 1));
+            if (!grown)
+            {
+                return false;
+            }
+            if (size_)
+            {
+                memcpy(grown, data_, size_);
+            }
+            data_ = grown;
+            max_size_ = capacity;
+            return true;
+        }
+
+        size_t capacity() const
+        {
+            return max_size_;
+        }
+
+      private:
+        monotonic_arena &arena_;
+    };
+
+} // namespace ulib
+
+#endif
@@ -6,10 +6,14 @@
 #ifndef MICROLIB_POOL_HPP__
 #define MICROLIB_POOL_HPP__
 
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <microlib/concurrency.hpp>
+#include <microlib/pool_statistics.hpp>
 #include <microlib/util.hpp>
 #include <new>
+#include <type_traits>
 #include <utility>
 
 
@@ -79,6 +83,290 @@ namespace ulib
             }
         };
 
+        // Element storage and freelist of a pool, serialized through the ConcurrencyTrait.
+        template <typename Element, size_t Size, typename ConcurrencyTrait>
+        struct pool_freelist : public ConcurrencyTrait
+        {
+            pool_freelist()
+            {
+                first_free_ = elements_;
+                for (size_t i = 0; i < Size - 1; ++i)
+                {
+                    elements_[i].set_next_free(&elements_[i + 1]);
+                }
+                elements_[Size - 1].set_next_free(nullptr);
+            }
+
+            Element *pop()
+            {
+                no_pool_statistics statistics;
+                return pop(statistics);
+            }
+
+            // Statistics are updated while the lock is held, so they need no synchronization of their own.
+            template <typename Statistics>
+            Element *pop(Statistics &statistics)
+            {
+                Element *result = nullptr;
+                ConcurrencyTrait::protect();
+                if (first_free_)
+                {
+                    result = first_free_;
+                    first_free_ = result->get_next_free();
+                    statistics.on_acquire(1);
+                }
+                else
+                {
+                    statistics.on_failure();
+                }
+                ConcurrencyTrait::unprotect();
+                return result;
+            }
+
+            void push(Element *elem)
+            {
+                no_pool_statistics statistics;
+                push(elem, statistics);
+            }
+
+            template <typename Statistics>
+            void push(Element *elem, Statistics &statistics)
+            {
+                ConcurrencyTrait::protect();
+                elem->set_next_free(first_free_);
+                first_free_ = elem;
+                statistics.on_release(1);
+                ConcurrencyTrait::unprotect();
+            }
+
+            // Pops up to n elements with a single protect()/unprotect() pair.
+            size_t pop_n(Element **out, size_t n)
+            {
+                size_t count = 0;
+                ConcurrencyTrait::protect();
+                while (count < n && first_free_)
+                {
+                    out[count++] = first_free_;
+                    first_free_ = first_free_->get_next_free();
+                }
+                ConcurrencyTrait::unprotect();
+                return count;
+            }
+
+            // Pushes n elements with a single protect()/unprotect() pair.
+            void push_n(Element *const *in, size_t n)
+            {
+                if (!n)
+                {
+                    return;
+                }
+
+                for (size_t i = 0; i < n - 1; ++i)
+                {
+                    in[i]->set_next_free(in[i + 1]);
+                }
+
+                ConcurrencyTrait::protect();
+                in[n - 1]->set_next_free(first_free_);
+                first_free_ = in[0];
+                ConcurrencyTrait::unprotect();
+            }
+
+#ifdef DEBUG_POOLS
+            // Calls check for every element on the freelist.
+            template <typename Check>
+            void for_each_free(Check check)
+            {
+                ConcurrencyTrait::protect();
+                for (Element *elem = first_free_; elem; elem = elem->get_next_free())
+                {
+                    check(elem);
+                }
+                ConcurrencyTrait::unprotect();
+            }
+#endif
+
+            Element elements_[Size];
+            Element *first_free_;
+        };
+
+        // Lock-free freelist (Treiber stack).
+        // The links are element indices kept in a side array rather than inside the element
+        // storage, so a pop racing with the new owner of a slot never reads payload bytes.
+        // The head packs the top index together with a generation count that is bumped on
+        // every successful exchange, so a head that was popped and pushed again in between
+        // fails the CAS instead of corrupting the list (ABA).
+        // The head is 64 bits wide wherever that is lock-free, which leaves 32 or more bits to the generation:
+        // a 16 bit count wraps after 64k exchanges, few enough for a preempted thread to miss a full cycle.
+        // Only targets without lock-free 64 bit atomics use a 32 bit head for pools of less than 64k elements.
+        template <typename Element, size_t Size>
+        struct pool_freelist<Element, Size, LockFree>
+        {
+            using index_type = conditional_t<(Size < 0xFFFF), uint16_t, uint32_t>;
+            using head_type =
+                conditional_t<(Size < 0xFFFF && !std::atomic<uint64_t>::is_always_lock_free), uint32_t, uint64_t>;
+
+            static constexpr index_type nil = index_type(~index_type(0));
+            static constexpr unsigned int index_bits = sizeof(index_type) * 8;
+
+            pool_freelist() : head_(pack(0, 0))
+            {
+                for (size_t i = 0; i < Size - 1; ++i)
+                {
+                    next_free_[i].store(index_type(i + 1), std::memory_order_relaxed);
+                }
+                next_free_[Size - 1].store(nil, std::memory_order_relaxed);
+            }
+
+            Element *pop()
+            {
+                head_type head = head_.load(std::memory_order_acquire);
+                for (;;)
+                {
+                    const index_type top = index(head);
+                    if (top == nil)
+                    {
+                        return nullptr;
+                    }
+
+                    // may be stale if another thread won the race, the CAS below catches that
+                    const index_type next = next_free_[top].load(std::memory_order_relaxed);
+                    if (head_.compare_exchange_weak(head, pack(next, generation(head) + 1), std::memory_order_acquire,
+                                                    std::memory_order_acquire))
+                    {
+                        return &elements_[top];
+                    }
+                }
+            }
+
+            void push(Element *elem)
+            {
+                const index_type idx = index_type(elem - elements_);
+                head_type head = head_.load(std::memory_order_relaxed);
+                do
+                {
+                    next_free_[idx].store(index(head), std::memory_order_relaxed);
+                } while (!head_.compare_exchange_weak(head, pack(idx, generation(head) + 1), std::memory_order_release,
+                                                      std::memory_order_relaxed));
+            }
+
+            // Statistics are updated outside the CAS and must synchronize themselves.
+            template <typename Statistics>
+            Element *pop(Statistics &statistics)
+            {
+                Element *result = pop();
+                if (result)
+                {
+                    statistics.on_acquire(1);
+                }
+                else
+                {
+                    statistics.on_failure();
+                }
+                return result;
+            }
+
+            template <typename Statistics>
+            void push(Element *elem, Statistics &statistics)
+            {
+                push(elem);
+                statistics.on_release(1);
+            }
+
+            // Pops up to n elements with a single successful CAS.
+            // Nothing below the head can change without changing the head's generation,
+            // so a successful CAS proves the walked chain was consistent.
+            size_t pop_n(Element **out, size_t n)
+            {
+                head_type head = head_.load(std::memory_order_acquire);
+                for (;;)
+                {
+                    size_t count = 0;
+                    index_type top = index(head);
+                    while (count < n && top != nil)
+                    {
+                        out[count++] = &elements_[top];
+                        top = next_free_[top].load(std::memory_order_relaxed);
+                    }
+
+                    if (!count)
+                    {
+                        return 0;
+                    }
+
+                    if (head_.compare_exchange_weak(head, pack(top, generation(head) + 1), std::memory_order_acquire,
+                                                    std::memory_order_acquire))
+                    {
+                        return count;
+                    }
+                }
+            }
+
+            // Links the n elements into a chain and pushes it with a single successful CAS.
+            void push_n(Element *const *in, size_t n)
+            {
+                if (!n)
+                {
+                    return;
+                }
+
+                for (size_t i = 0; i < n - 1; ++i)
+                {
+                    next_free_[in[i] - elements_].store(index_type(in[i + 1] - elements_), std::memory_order_relaxed);
+                }
+
+                const index_type first = index_type(in[0] - elements_);
+                const index_type last = index_type(in[n - 1] - elements_);
+                head_type head = head_.load(std::memory_order_relaxed);
+                do
+                {
+                    next_free_[last].store(index(head), std::memory_order_relaxed);
+                } while (!head_.compare_exchange_weak(head, pack(first, generation(head) + 1), std::memory_order_release,
+                                                      std::memory_order_relaxed));
+            }
+
+#ifdef DEBUG_POOLS
+            // Calls check for every element on the free chain as seen right now, or with nullptr for a broken link.
+            // Concurrent pops and pushes may change the chain during the walk, so it stops after Size links.
+            template <typename Check>
+            void for_each_free(Check check)
+            {
+                index_type top = index(head_.load(std::memory_order_acquire));
+                for (size_t links = 0; top != nil && links < Size; ++links)
+                {
+                    if (top >= Size)
+                    {
+                        check(static_cast<Element *>(nullptr));
+                        return;
+                    }
+                    check(&elements_[top]);
+                    top = next_free_[top].load(std::memory_order_relaxed);
+                }
+            }
+#endif
+
+            static constexpr head_type pack(index_type idx, head_type gen)
+            {
+                return (gen << index_bits) | idx;
+            }
+
+            static constexpr index_type index(head_type head)
+            {
+                return index_type(head);
+            }
+
+            static constexpr head_type generation(head_type head)
+            {
+                return head >> index_bits;
+            }
+
+            Element elements_[Size];
+            std::atomic<index_type> next_free_[Size];
+
+            // keep the contended head away from the element storage
+            alignas(64) std::atomic<head_type> head_;
+        };
+
     } // namespace detail
 
     template <typename Type>
@@ -200,8 +488,12 @@ namespace ulib
         pointer_type the_element_;
     };
 
-    template <typename Type, size_t Size, typename ConcurrencyTrait = NoConcurrency>
-    struct pool : public ConcurrencyTrait
+    // Fixed size pool handing out pool_ptr.
+    // Pass LockFree as ConcurrencyTrait to share the pool between threads without a lock.
+    // Pass pool_statistics as Statistics to track usage, see statistics().
+    template <typename Type, size_t Size, typename ConcurrencyTrait = NoConcurrency, typename Statistics = no_pool_statistics>
+    struct pool : private detail::pool_freelist<detail::pool_element_type<Type>, Size, ConcurrencyTrait>,
+                  private detail::pool_statistics_type<Statistics, ConcurrencyTrait>
     {
         using element_type = detail::pool_element_type<Type>;
         using pointer_type = pool_ptr<Type>;
@@ -211,13 +503,10 @@ namespace ulib
             trampoline_.func = free_func;
             trampoline_.pool = this;
 
-            first_free_ = elements_;
             for (size_t i = 0; i < Size; ++i)
             {
-                elements_[i].trampoline_ = &trampoline_;
-                elements_[i].set_next_free(&elements_[i + 1]);
+                freelist::elements_[i].trampoline_ = &trampoline_;
             }
-            elements_[Size - 1].set_next_free(nullptr);
         }
 
         static void free_func(element_type *elem, void *arg)
@@ -240,35 +529,45 @@ namespace ulib
             }
         }
 
+        // Only available with an enabled Statistics policy.
+        pool_statistics_snapshot statistics()
+        {
+            if constexpr (std::is_same<ConcurrencyTrait, LockFree>::value)
+            {
+                return statistics_type::snapshot();
+            }
+            else
+            {
+                ConcurrencyTrait::protect();
+                const pool_statistics_snapshot result = statistics_type::snapshot();
+                ConcurrencyTrait::unprotect();
+                return result;
+            }
+        }
+
       private:
+        using freelist = detail::pool_freelist<element_type, Size, ConcurrencyTrait>;
+        using statistics_type = detail::pool_statistics_type<Statistics, ConcurrencyTrait>;
+
 #ifdef DEBUG_POOLS
         void check_integrity()
         {
-            ConcurrencyTrait::protect();
             for (size_t i = 0; i < Size; ++i)
             {
-                if (elements_[i].pool_ != this)
+                if (freelist::elements_[i].trampoline_ != &trampoline_)
                 {
                     for (;;)
                         ;
                 }
             }
 
-            auto *buff = first_free_;
-            while (buff)
-            {
-                auto *next = buff->get_next_free();
-                if (next)
+            freelist::for_each_free([this](element_type *elem) {
+                if (!elem || elem->trampoline_ != &trampoline_)
                 {
-                    if (next->pool_ != this)
-                    {
-                        for (;;)
-                            ;
-                    }
+                    for (;;)
+                        ;
                 }
-                buff = next;
-            }
-            ConcurrencyTrait::unprotect();
+            });
         }
 #endif
 
@@ -278,36 +577,23 @@ namespace ulib
             check_integrity();
 #endif
 
-            element_type *result = nullptr;
-            ConcurrencyTrait::protect();
-            if (first_free_)
-            {
-                result = first_free_;
-                first_free_ = result->get_next_free();
-            }
-            ConcurrencyTrait::unprotect();
-            return result;
+            return freelist::pop(static_cast<statistics_type &>(*this));
         }
 
         void release(element_type *elem)
         {
 #ifdef DEBUG_POOLS
-            if (elem->pool_ != this)
+            if (elem->trampoline_ != &trampoline_)
             {
                 for (;;)
                     ;
             }
 #endif
             elem->destroy();
-            ConcurrencyTrait::protect();
-            elem->set_next_free(first_free_);
-            first_free_ = elem;
-            ConcurrencyTrait::unprotect();
+            freelist::push(elem, static_cast<statistics_type &>(*this));
         }
 
       private:
-        element_type elements_[Size];
-        element_type *first_free_;
         detail::trampoline<Type> trampoline_;
     };
 
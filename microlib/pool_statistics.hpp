@@ -0,0 +1,224 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MICROLIB_POOL_STATISTICS_HPP__
+#define MICROLIB_POOL_STATISTICS_HPP__
+
+#include <atomic>
+#include <cstddef>
+#include <microlib/concurrency.hpp>
+
+namespace ulib
+{
+
+    //
+    // Statistics policies for pool and intrusive_pool.
+    // A policy gets notified of successful acquisitions (on_acquire), failed ones (on_failure) and
+    // releases (on_release). The pools derive from it, so the default no_pool_statistics costs nothing.
+    //
+    // pool_statistics picks the counters matching the pool's ConcurrencyTrait:
+    //  - Pools serialized by protect()/unprotect() update plain integers while holding the lock they take anyway.
+    //  - LockFree pools count per thread into shards of relaxed atomics, each shard on a cache line of its own.
+    //    in_use is allocations - releases summed over the shards. The high-water mark is sampled every
+    //    sample_interval allocations of a thread, on every failure and by statistics(), so it can miss short peaks.
+    //
+
+    struct pool_statistics_snapshot
+    {
+        size_t in_use;
+        size_t high_water;
+        size_t failures;
+        size_t allocations;
+    };
+
+    struct no_pool_statistics
+    {
+        static constexpr bool enabled = false;
+
+        void on_acquire(size_t)
+        {
+        }
+
+        void on_failure()
+        {
+        }
+
+        void on_release(size_t)
+        {
+        }
+    };
+
+    // Selects the counters fitting the pool's ConcurrencyTrait, see above.
+    struct pool_statistics
+    {
+    };
+
+    namespace detail
+    {
+
+        // Plain counters, the pool serializes the calls.
+        struct plain_pool_statistics
+        {
+            static constexpr bool enabled = true;
+
+            plain_pool_statistics() : in_use_(0), high_water_(0), failures_(0), allocations_(0)
+            {
+            }
+
+            void on_acquire(size_t n)
+            {
+                in_use_ += n;
+                allocations_ += n;
+                if (in_use_ > high_water_)
+                {
+                    high_water_ = in_use_;
+                }
+            }
+
+            void on_failure()
+            {
+                ++failures_;
+            }
+
+            void on_release(size_t n)
+            {
+                in_use_ -= n;
+            }
+
+            pool_statistics_snapshot snapshot()
+            {
+                return {in_use_, high_water_, failures_, allocations_};
+            }
+
+          private:
+            size_t in_use_;
+            size_t high_water_;
+            size_t failures_;
+            size_t allocations_;
+        };
+
+        // Per-thread shards of relaxed atomics. A thread only writes its own shard, so the counters stay
+        // in its cache; threads only share a shard when there are more threads than shards.
+        struct sharded_pool_statistics
+        {
+            static constexpr bool enabled = true;
+            static constexpr size_t shards = 16;
+            static constexpr size_t sample_interval = 64;
+
+            sharded_pool_statistics() : high_water_(0)
+            {
+                for (shard &own : shards_)
+                {
+                    own.allocations_.store(0, std::memory_order_relaxed);
+                    own.releases_.store(0, std::memory_order_relaxed);
+                    own.failures_.store(0, std::memory_order_relaxed);
+                }
+            }
+
+            void on_acquire(size_t n)
+            {
+                const size_t allocations = local_shard().allocations_.fetch_add(n, std::memory_order_relaxed) + n;
+                if (allocations % sample_interval < n)
+                {
+                    sample();
+                }
+            }
+
+            void on_failure()
+            {
+                local_shard().failures_.fetch_add(1, std::memory_order_relaxed);
+                sample();
+            }
+
+            void on_release(size_t n)
+            {
+                local_shard().releases_.fetch_add(n, std::memory_order_relaxed);
+            }
+
+            pool_statistics_snapshot snapshot()
+            {
+                size_t failures = 0;
+                size_t allocations = 0;
+                for (const shard &own : shards_)
+                {
+                    failures += own.failures_.load(std::memory_order_relaxed);
+                    allocations += own.allocations_.load(std::memory_order_relaxed);
+                }
+                const size_t in_use = sample();
+                return {in_use, high_water_.load(std::memory_order_relaxed), failures, allocations};
+            }
+
+          private:
+            struct alignas(64) shard
+            {
+                std::atomic<size_t> allocations_;
+                std::atomic<size_t> releases_;
+                std::atomic<size_t> failures_;
+            };
+
+            shard &local_shard()
+            {
+                static std::atomic<size_t> next_shard(0);
+                static thread_local const size_t index = next_shard.fetch_add(1, std::memory_order_relaxed) % shards;
+                return shards_[index];
+            }
+
+            // Sums the shards into the current in-use count and raises the high-water mark to it.
+            size_t sample()
+            {
+                // releases first: a release counted here belongs to an allocation that is counted afterwards,
+                // only racing acquisitions and releases can make the difference slightly off
+                size_t releases = 0;
+                for (const shard &own : shards_)
+                {
+                    releases += own.releases_.load(std::memory_order_relaxed);
+                }
+                size_t allocations = 0;
+                for (const shard &own : shards_)
+                {
+                    allocations += own.allocations_.load(std::memory_order_relaxed);
+                }
+                const size_t in_use = allocations > releases ? allocations - releases : 0;
+
+                size_t high_water = high_water_.load(std::memory_order_relaxed);
+                while (in_use > high_water && !high_water_.compare_exchange_weak(high_water, in_use, std::memory_order_relaxed))
+                {
+                }
+                return in_use;
+            }
+
+            shard shards_[shards];
+            alignas(64) std::atomic<size_t> high_water_;
+        };
+
+        template <typename Statistics, typename ConcurrencyTrait>
+        struct select_pool_statistics
+        {
+            using type = Statistics;
+        };
+
+        template <typename ConcurrencyTrait>
+        struct select_pool_statistics<pool_statistics, ConcurrencyTrait>
+        {
+            using type = plain_pool_statistics;
+        };
+
+        template <>
+        struct select_pool_statistics<pool_statistics, LockFree>
+        {
+            using type = sharded_pool_statistics;
+        };
+
+        template <typename Statistics, typename ConcurrencyTrait>
+        using pool_statistics_type = typename select_pool_statistics<Statistics, ConcurrencyTrait>::type;
+
+    } // namespace detail
+
+    // Plain counters without any synchronization, for LockFree pools only ever used from a single thread.
+    using unsynchronized_pool_statistics = detail::plain_pool_statistics;
+
+} // namespace ulib
+
+#endif
@@ -6,150 +6,133 @@
 #ifndef MICROLIB_PRIORITY_QUEUE_HPP__
 #define MICROLIB_PRIORITY_QUEUE_HPP__
 
-#include <algorithm>
 #include <functional>
-#include <microlib/static_vector.hpp>
+#include <microlib/serial_compare.hpp>
+#include <microlib/static_heap.hpp>
+#include <utility>
 
 
 namespace ulib
 {
 
-    // FIXME: Replace with with static_heap/static_interval_heap or sorted vector implementation
+    namespace detail
+    {
+
+        // Swaps the arguments, so a min heap on it is a max heap on Compare.
+        template <typename Compare>
+        struct reverse_compare : private Compare
+        {
+            reverse_compare(Compare compare = Compare()) : Compare(std::move(compare))
+            {
+            }
+
+            template <typename A, typename B>
+            bool operator()(const A &a, const B &b)
+            {
+                return Compare::operator()(b, a);
+            }
+        };
 
+    } // namespace detail
+
+    //
+    // Priority queue with static capacity of Size, following std::priority_queue:
+    // top() is the greatest element with respect to Compare.
+    // A thin adaptor over static_heap, whose top is the least element.
+    //
     template <typename Element, size_t Size, typename Compare = std::less<Element>>
     struct static_priority_queue
     {
       public:
-        using container_type = static_vector<Element, Size>;
-        using iterator = typename container_type::iterator;
-        using const_iterator = typename container_type::const_iterator;
+        using heap_type = static_heap<Element, Size, detail::reverse_compare<Compare>>;
+        using iterator = typename heap_type::iterator;
+        using const_iterator = typename heap_type::const_iterator;
+        using size_type = typename heap_type::size_type;
 
       public:
+        static_priority_queue(Compare compare = Compare()) : heap_(detail::reverse_compare<Compare>(std::move(compare)))
+        {
+        }
+
+        // Inserts an element constructed from the given arguments.
+        // Returns false iff there is not enough storage capacity left.
         template <typename... Args>
         bool insert(Args &&... args)
         {
-            if (data_.emplace_back(std::forward<Args>(args)...))
-            {
-                std::push_heap(data_.begin(), data_.end(), Compare());
-            }
-            else
-            {
-                return false;
-            }
+            return heap_.emplace(std::forward<Args>(args)...);
         }
 
+        // Removes the top element. UB if the queue is empty.
         void pop()
         {
-            std::pop_heap(data_.begin(), data_.end());
+            heap_.pop();
         }
 
         Element &top()
         {
-            return data_[0];
+            return heap_.top_element();
         }
 
         const Element &top() const
         {
-            return data_[0];
+            return heap_.top_element();
         }
 
         iterator begin()
         {
-            return data_.begin();
+            return heap_.begin();
         }
 
         iterator end()
         {
-            return data_.end();
+            return heap_.end();
         }
 
-        const iterator begin() const
+        const_iterator begin() const
         {
-            return data_.begin();
+            return heap_.begin();
         }
 
         const_iterator end() const
         {
-            return data_.end();
+            return heap_.end();
         }
 
-        // try not to call this.
+        // Removes the element at the given position in O(log n).
         void erase(const_iterator it)
         {
-            data_.erase(it);
-            std::make_heap(begin(), end());
-        }
-
-      private:
-        static_vector<Element, Size> data_;
-    };
-
-    template <typename Element, size_t Size, typename Compare = std::less<Element>>
-    struct static_priority_queue_wrap_around
-    {
-      public:
-        using container_type = static_vector<Element, Size>;
-        using iterator = typename container_type::iterator;
-        using const_iterator = typename container_type::const_iterator;
-
-      public:
-        template <typename... Args>
-        bool insert(Args &&... args)
-        {
-            if (data_.emplace_back(std::forward<Args>(args)...))
-            {
-                std::push_heap(data_.begin(), data_.end(), Compare());
-            }
-            else
-            {
-                return false;
-            }
+            heap_.erase(it);
         }
 
-        void pop()
+        size_type size() const
         {
-            std::pop_heap(data_.begin(), data_.end());
+            return heap_.size();
         }
 
-        Element &top()
+        bool empty() const
         {
-            return data_[0];
+            return heap_.size() == 0;
         }
 
-        const Element &top() const
-        {
-            return data_[0];
-        }
-
-        iterator begin()
-        {
-            return data_.begin();
-        }
-
-        iterator end()
+        size_type capacity() const
         {
-            return data_.end();
-        }
-
-        const iterator begin() const
-        {
-            return data_.begin();
-        }
-
-        const_iterator end() const
-        {
-            return data_.end();
-        }
-
-        // try not to call this.
-        void erase(const_iterator it)
-        {
-            data_.erase(it);
-            std::make_heap(begin(), end());
+            return heap_.capacity();
         }
 
       private:
-        static_vector<Element, Size> data_;
+        heap_type heap_;
+    };
+
+    //
+    // Priority queue over wrapping counters (sequence numbers, tick timestamps) of unsigned type Element:
+    // top() is the newest element in serial number order (see serial_less), which stays correct
+    // across the wrap-around as long as all queued elements lie within half the number space.
+    // Pass a comparator on a key member for elements which are not plain counters.
+    //
+    template <typename Element, size_t Size, typename Compare = serial_less<Element>>
+    struct static_priority_queue_wrap_around : public static_priority_queue<Element, Size, Compare>
+    {
+        using static_priority_queue<Element, Size, Compare>::static_priority_queue;
     };
 
 } // namespace ulib
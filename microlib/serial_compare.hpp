@@ -0,0 +1,89 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MICROLIB_SERIAL_COMPARE_HPP__
+#define MICROLIB_SERIAL_COMPARE_HPP__
+
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+
+namespace ulib
+{
+
+    //
+    // Serial number arithmetic (RFC 1982) for wrapping counters like sequence numbers and tick timestamps.
+    // Counters are Bits wide and stored in the unsigned type T (Bits defaults to the full width of T,
+    // values must stay below 2^Bits). a precedes b iff b is less than half the number space ahead of a,
+    // modulo wrap-around; two numbers exactly half the space apart are unordered.
+    // The comparators are strict weak orderings only as long as all compared values lie within
+    // half the number space of each other, which is what queues of in-flight counters guarantee.
+    // The heaps recognize them and use their SIMD child selection where one exists.
+    //
+
+    namespace detail
+    {
+
+        template <typename T, size_t Bits>
+        struct serial_space
+        {
+            static_assert(std::is_unsigned<T>::value, "Serial numbers must be unsigned.");
+            static_assert(Bits >= 2 && Bits <= size_t(std::numeric_limits<T>::digits), "Bits must fit into T.");
+
+            static constexpr T mask = T(std::numeric_limits<T>::max() >> (std::numeric_limits<T>::digits - Bits));
+            static constexpr T half = T(T(1) << (Bits - 1));
+
+            // b - a modulo 2^Bits
+            static constexpr T distance(T a, T b)
+            {
+                return T(T(b - a) & mask);
+            }
+        };
+
+    } // namespace detail
+
+    template <typename T, size_t Bits = size_t(std::numeric_limits<T>::digits)>
+    struct serial_less
+    {
+        using space = detail::serial_space<T, Bits>;
+        static constexpr size_t bits = Bits;
+
+        constexpr bool operator()(T a, T b) const
+        {
+            return space::distance(a, b) != 0 && space::distance(a, b) < space::half;
+        }
+    };
+
+    template <typename T, size_t Bits = size_t(std::numeric_limits<T>::digits)>
+    struct serial_greater
+    {
+        using space = detail::serial_space<T, Bits>;
+        static constexpr size_t bits = Bits;
+
+        constexpr bool operator()(T a, T b) const
+        {
+            return serial_less<T, Bits>()(b, a);
+        }
+    };
+
+    // s + n modulo 2^Bits. RFC 1982 only defines this for n < 2^(Bits - 1).
+    template <size_t Bits, typename T>
+    constexpr T serial_add(T s, T n)
+    {
+        return T(T(s + n) & detail::serial_space<T, Bits>::mask);
+    }
+
+    // Signed distance from a to b, i.e. how far b is ahead of a (negative if behind).
+    // Undefined for numbers exactly half the space apart.
+    template <size_t Bits, typename T>
+    constexpr long long serial_difference(T a, T b)
+    {
+        using space = detail::serial_space<T, Bits>;
+        return space::distance(a, b) < space::half ? (long long)space::distance(a, b) : -(long long)space::distance(b, a);
+    }
+
+} // namespace ulib
+
+#endif
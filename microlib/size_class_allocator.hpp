@@ -0,0 +1,321 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MICROLIB_SIZE_CLASS_ALLOCATOR_HPP__
+#define MICROLIB_SIZE_CLASS_ALLOCATOR_HPP__
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <memory_resource>
+#include <microlib/concurrency.hpp>
+#include <microlib/util.hpp>
+
+namespace ulib
+{
+
+    //
+    // Size class lists for size_class_allocator: list<16, 32, 64> spells one out, the generators below
+    // build common ones, always ending at exactly Max.
+    //
+    namespace size_classes
+    {
+
+        template <size_t... Sizes>
+        struct list
+        {
+        };
+
+        namespace detail
+        {
+
+            template <typename List, size_t Size>
+            struct push_back;
+
+            template <size_t... Sizes, size_t Size>
+            struct push_back<list<Sizes...>, Size>
+            {
+                using type = list<Sizes..., Size>;
+            };
+
+            template <typename List, size_t Current, size_t Max, typename Step, bool Done = (Current >= Max)>
+            struct generate
+            {
+                using type = typename generate<typename push_back<List, Current>::type, Step::next(Current), Max, Step>::type;
+            };
+
+            template <typename List, size_t Current, size_t Max, typename Step>
+            struct generate<List, Current, Max, Step, true>
+            {
+                using type = typename push_back<List, Max>::type;
+            };
+
+            struct double_step
+            {
+                static constexpr size_t next(size_t size)
+                {
+                    return size * 2;
+                }
+            };
+
+            template <size_t Granularity>
+            struct quarter_step
+            {
+                static constexpr size_t next(size_t size)
+                {
+                    return ((size + size / 4 + Granularity - 1) / Granularity) * Granularity;
+                }
+            };
+
+        } // namespace detail
+
+        // Min, 2 * Min, 4 * Min, ..., Max
+        template <size_t Min, size_t Max>
+        using power_of_2 = typename detail::generate<list<>, Min, Max, detail::double_step>::type;
+
+        // Every class 1.25 times the previous one, rounded up to a multiple of Granularity.
+        template <size_t Min, size_t Max, size_t Granularity = alignof(std::max_align_t)>
+        using quarter_steps = typename detail::generate<list<>, Min, Max, detail::quarter_step<Granularity>>::type;
+
+    } // namespace size_classes
+
+    namespace detail
+    {
+
+        // largest power of 2 dividing size, capped at the fundamental alignment
+        constexpr size_t size_class_alignment(size_t size)
+        {
+            return min(size & (~size + 1), alignof(std::max_align_t));
+        }
+
+    } // namespace detail
+
+    template <typename Sizes, size_t BlocksPerClass, typename ConcurrencyTrait = NoConcurrency>
+    class size_class_allocator;
+
+    //
+    // Segregated fit allocator: one fixed block freelist per size class, all inside one static buffer.
+    // allocate() serves a request from the smallest class that fits and has a free block left,
+    // found through a table indexed by the size in 8 byte granules.
+    // deallocate() finds the class through a map from 256 byte address granules to classes, so it needs no size.
+    // All classes share the same code path (no per-class dispatch), which keeps branches predictable
+    // when request sizes are not.
+    // Blocks are aligned to the largest power of 2 dividing their size, at most to alignof(std::max_align_t).
+    //
+    template <size_t... Sizes, size_t BlocksPerClass, typename ConcurrencyTrait>
+    class size_class_allocator<size_classes::list<Sizes...>, BlocksPerClass, ConcurrencyTrait> : public ConcurrencyTrait
+    {
+        static_assert(sizeof...(Sizes) > 0, "At least one size class is required.");
+        static_assert(sizeof...(Sizes) < 255, "Too many size classes.");
+        static_assert(BlocksPerClass > 0, "At least one block per class is required.");
+
+        static constexpr size_t classes = sizeof...(Sizes);
+        static constexpr size_t sizes[] = {Sizes...};
+        static constexpr size_t size_granule = 8;
+        static constexpr size_t address_granule = 256;
+        static constexpr unsigned char no_class = 0xFF;
+
+        static constexpr bool ascending()
+        {
+            for (size_t i = 1; i < classes; ++i)
+            {
+                if (sizes[i - 1] >= sizes[i])
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        static_assert(ascending(), "Size classes must be strictly ascending.");
+
+        // blocks must be able to hold the freelist link
+        static constexpr size_t stride(size_t cls)
+        {
+            return max(sizes[cls], sizeof(void *));
+        }
+
+        // every class starts on a new address granule
+        static constexpr size_t class_offset(size_t cls)
+        {
+            size_t offset = 0;
+            for (size_t i = 0; i < cls; ++i)
+            {
+                offset += (stride(i) * BlocksPerClass + address_granule - 1) / address_granule * address_granule;
+            }
+            return offset;
+        }
+
+        static constexpr size_t storage_size = class_offset(classes);
+
+      public:
+        static constexpr size_t largest_block = sizes[classes - 1];
+
+        size_class_allocator()
+        {
+            for (size_t cls = 0; cls < classes; ++cls)
+            {
+                unsigned char *block = storage_ + class_offset(cls);
+                first_free_[cls] = block;
+                for (size_t i = 0; i < BlocksPerClass - 1; ++i, block += stride(cls))
+                {
+                    set_next_free(block, block + stride(cls));
+                }
+                set_next_free(block, nullptr);
+            }
+        }
+
+        size_class_allocator(const size_class_allocator &) = delete;
+        size_class_allocator &operator=(const size_class_allocator &) = delete;
+
+        // Returns nullptr if no class large enough and aligned at least to align has a free block.
+        void *allocate(size_t bytes, size_t align = 1)
+        {
+            if (bytes > largest_block)
+            {
+                return nullptr;
+            }
+
+            void *result = nullptr;
+            ConcurrencyTrait::protect();
+            for (size_t cls = first_class[(bytes + size_granule - 1) / size_granule]; cls < classes; ++cls)
+            {
+                if (first_free_[cls] && align <= detail::size_class_alignment(sizes[cls]))
+                {
+                    result = first_free_[cls];
+                    first_free_[cls] = get_next_free(first_free_[cls]);
+                    break;
+                }
+            }
+            ConcurrencyTrait::unprotect();
+            return result;
+        }
+
+        // ptr must stem from allocate() of this allocator or be nullptr.
+        void deallocate(void *ptr)
+        {
+            if (ptr)
+            {
+                const size_t cls = class_map[granule_of(ptr)];
+                ConcurrencyTrait::protect();
+                set_next_free(ptr, first_free_[cls]);
+                first_free_[cls] = static_cast<unsigned char *>(ptr);
+                ConcurrencyTrait::unprotect();
+            }
+        }
+
+        bool owns(const void *ptr) const
+        {
+            auto *p = static_cast<const unsigned char *>(ptr);
+            return p >= storage_ && p < storage_ + storage_size && class_map[granule_of(ptr)] != no_class;
+        }
+
+      private:
+        // first_class[g] is the first class holding g size granules
+        static constexpr auto make_first_class()
+        {
+            std::array<unsigned char, largest_block / size_granule + 2> result{};
+            size_t cls = 0;
+            for (size_t g = 0; g < result.size(); ++g)
+            {
+                while (cls < classes && sizes[cls] < g * size_granule)
+                {
+                    ++cls;
+                }
+                result[g] = (unsigned char)cls;
+            }
+            return result;
+        }
+
+        // class_map[g] is the class owning address granule g of the storage, if any
+        static constexpr auto make_class_map()
+        {
+            std::array<unsigned char, storage_size / address_granule> result{};
+            for (size_t g = 0; g < result.size(); ++g)
+            {
+                result[g] = no_class;
+            }
+            for (size_t cls = 0; cls < classes; ++cls)
+            {
+                const size_t first = class_offset(cls) / address_granule;
+                const size_t last = (class_offset(cls) + stride(cls) * BlocksPerClass - 1) / address_granule;
+                for (size_t g = first; g <= last; ++g)
+                {
+                    result[g] = (unsigned char)cls;
+                }
+            }
+            return result;
+        }
+
+        static constexpr auto first_class = make_first_class();
+        static constexpr auto class_map = make_class_map();
+
+        size_t granule_of(const void *ptr) const
+        {
+            return size_t(static_cast<const unsigned char *>(ptr) - storage_) / address_granule;
+        }
+
+        // blocks may be less aligned than a pointer
+        static void set_next_free(void *block, unsigned char *next)
+        {
+            std::memcpy(block, &next, sizeof(next));
+        }
+
+        static unsigned char *get_next_free(const void *block)
+        {
+            unsigned char *next;
+            std::memcpy(&next, block, sizeof(next));
+            return next;
+        }
+
+        alignas(address_granule) unsigned char storage_[storage_size];
+        unsigned char *first_free_[classes];
+    };
+
+    //
+    // std::pmr adaptor. Requests the allocator cannot serve (too large, over-aligned or exhausted)
+    // go to the upstream resource, which throws std::bad_alloc by default.
+    //
+    template <typename Allocator>
+    class size_class_resource : public std::pmr::memory_resource
+    {
+      public:
+        size_class_resource(Allocator &allocator, std::pmr::memory_resource *upstream = std::pmr::null_memory_resource())
+            : allocator_(allocator), upstream_(upstream)
+        {
+        }
+
+      private:
+        void *do_allocate(size_t bytes, size_t align) override
+        {
+            void *result = allocator_.allocate(bytes, align);
+            return result ? result : upstream_->allocate(bytes, align);
+        }
+
+        void do_deallocate(void *ptr, size_t bytes, size_t align) override
+        {
+            if (allocator_.owns(ptr))
+            {
+                allocator_.deallocate(ptr);
+            }
+            else
+            {
+                upstream_->deallocate(ptr, bytes, align);
+            }
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+        {
+            return this == &other;
+        }
+
+        Allocator &allocator_;
+        std::pmr::memory_resource *upstream_;
+    };
+
+} // namespace ulib
+
+#endif
@@ -6,8 +6,12 @@
 #ifndef MICROLIB_SORTING_HPP__
 #define MICROLIB_SORTING_HPP__
 
+#include "detail/inplace_merge.hpp"
+#include "detail/sorted_search.hpp"
 #include <algorithm>
+#include <cstring>
 #include <functional>
+#include <iterator>
 #include <microlib/static_vector.hpp>
 #include <microlib/util.hpp>
 #include <utility>
@@ -20,10 +24,87 @@ namespace ulib
     // presorted data Use insert_binary only if comparison costs far outweigh swap costs!
     //
     // alternative to pursue might be a shell sort implementation
+    //
+    // Elements are shifted through a hole rather than swapped: the element to place is moved out once, its
+    // neighbours move over by one, and it is moved back into the hole, one move per step instead of a swap's three.
+    // Trivially copyable elements in contiguous storage are located first and then shifted with a single memmove.
 
     namespace insertion_sort
     {
 
+        template <typename Iterator>
+        struct memmove_shift
+        {
+            static constexpr bool value =
+                std::is_pointer<Iterator>::value && std::is_trivially_copyable<typename std::iterator_traits<Iterator>::value_type>::value;
+        };
+
+        // Moves the element at pos towards begin past all elements ordered after it.
+        // Returns its new position.
+        template <typename Iterator, typename Compare>
+        Iterator shift_back(Iterator begin, Iterator pos, Compare &compare)
+        {
+            if (pos == begin || !compare(*pos, *(pos - 1)))
+            {
+                return pos;
+            }
+
+            typename std::iterator_traits<Iterator>::value_type val(std::move(*pos));
+            Iterator hole = pos - 1;
+            if constexpr (memmove_shift<Iterator>::value)
+            {
+                while (hole != begin && compare(val, *(hole - 1)))
+                {
+                    --hole;
+                }
+                std::memmove(static_cast<void *>(hole + 1), static_cast<const void *>(hole), size_t(pos - hole) * sizeof(val));
+            }
+            else
+            {
+                *pos = std::move(*hole);
+                while (hole != begin && compare(val, *(hole - 1)))
+                {
+                    *hole = std::move(*(hole - 1));
+                    --hole;
+                }
+            }
+            *hole = std::move(val);
+            return hole;
+        }
+
+        // Moves the element at pos towards end past all elements ordered before it.
+        // Returns its new position.
+        template <typename Iterator, typename Compare>
+        Iterator shift_forward(Iterator pos, Iterator end, Compare &compare)
+        {
+            if (pos + 1 == end || !compare(*(pos + 1), *pos))
+            {
+                return pos;
+            }
+
+            typename std::iterator_traits<Iterator>::value_type val(std::move(*pos));
+            Iterator hole = pos + 1;
+            if constexpr (memmove_shift<Iterator>::value)
+            {
+                while (hole + 1 != end && compare(*(hole + 1), val))
+                {
+                    ++hole;
+                }
+                std::memmove(static_cast<void *>(pos), static_cast<const void *>(pos + 1), size_t(hole - pos) * sizeof(val));
+            }
+            else
+            {
+                *pos = std::move(*hole);
+                while (hole + 1 != end && compare(*(hole + 1), val))
+                {
+                    *hole = std::move(*(hole + 1));
+                    ++hole;
+                }
+            }
+            *hole = std::move(val);
+            return hole;
+        }
+
         template <typename Iterator, typename Compare>
         void insert_binary_back(Iterator begin, Iterator end, Compare &&compare)
         {
@@ -33,7 +114,7 @@ namespace ulib
         template <typename Iterator, typename Compare>
         void insert_binary_front(Iterator begin, Iterator end, Compare &&compare)
         {
-            std::rotate(begin, std::upper_bound(begin + 1, end, *begin, std::forward<Compare>(compare)), end);
+            std::rotate(begin, begin + 1, std::upper_bound(begin + 1, end, *begin, std::forward<Compare>(compare)));
         }
 
         template <typename Iterator, typename Compare>
@@ -41,10 +122,7 @@ namespace ulib
         {
             if (begin != end)
             {
-                for (auto temp = end - 1; temp != begin && !compare(*(temp - 1), *temp, std::forward<Compare>(compare)); --temp)
-                {
-                    std::swap(*(temp - 1), *temp);
-                }
+                shift_back(begin, end - 1, compare);
             }
         }
 
@@ -54,7 +132,7 @@ namespace ulib
         {
             for (auto it = begin + 1; it != end; ++it)
             {
-                insert(begin, it, compare);
+                insert(begin, it + 1, compare);
             }
         }
 
@@ -71,7 +149,7 @@ namespace ulib
         {
             for (auto it = begin + 1; it != end; ++it)
             {
-                insert_binary_back(begin, it, compare);
+                insert_binary_back(begin, it + 1, compare);
             }
         }
 
@@ -85,17 +163,7 @@ namespace ulib
         template <typename Iterator, typename Compare>
         void restore_invariant(Iterator begin, Iterator end, Iterator elem, Compare &&compare)
         {
-            while (elem != begin && !compare(*(elem - 1), *elem))
-            {
-                std::swap(*(elem - 1), *elem);
-                --elem;
-            }
-
-            while (elem + 1 != end && compare(*(elem + 1), *elem))
-            {
-                std::swap(*(elem + 1), *elem);
-                ++elem;
-            }
+            shift_forward(shift_back(begin, elem, compare), end, compare);
         }
 
         template <typename Iterator, typename Compare>
@@ -155,6 +223,68 @@ namespace ulib
             }
         }
 
+        // Inserts the elements of [first, last): they are appended, sorted among themselves and merged with the
+        // elements already present. Equivalent elements keep the order single insertions would give them.
+        // Takes at most capacity() - size() elements, returns the number taken.
+        // Sorting and merging never allocate, the unused capacity serves as scratch space (see detail/inplace_merge.hpp):
+        // O(m log m + n) moves with room for m / 2 more elements, somewhat more on a full vector, far fewer
+        // than the O(n m) of m single insertions either way.
+        template <typename InputIterator>
+        size_type insert_range(InputIterator first, InputIterator last)
+        {
+            const size_type old_size = size();
+            const size_type count = append(first, last);
+            Compare &compare = *static_cast<Compare *>(this);
+            T *const scratch = data_.end();
+            const size_t scratch_size = size_t(capacity() - size());
+            detail::stable_sort_in_place(begin() + old_size, end(), compare, scratch, scratch_size);
+            detail::merge_in_place(begin(), begin() + old_size, end(), compare, scratch, scratch_size);
+            return count;
+        }
+
+        // Inserts the elements of another sorted vector in a single backward merge pass, O(n + m).
+        // Takes at most capacity() - size() elements (the smallest ones), returns the number taken.
+        template <size_t OtherSize>
+        size_type merge(const sorted_static_vector<T, OtherSize, Compare> &other)
+        {
+            const size_type old_size = size();
+            const size_type count = append(other.begin(), other.end());
+            Compare &compare = *static_cast<Compare *>(this);
+            if (static_cast<const void *>(&other) == static_cast<const void *>(this))
+            {
+                // the source is overwritten by the merge, merge the appended copies in place instead
+                detail::merge_in_place(begin(), begin() + old_size, end(), compare);
+                return count;
+            }
+
+            // fills from the back, the slot written is never one of the elements still to be merged
+            size_type kept = old_size;
+            size_type taken = count;
+            while (taken)
+            {
+                if (kept && compare(other[taken - 1], data_[kept - 1]))
+                {
+                    data_[kept + taken - 1] = std::move(data_[kept - 1]);
+                    --kept;
+                }
+                else
+                {
+                    data_[kept + taken - 1] = other[taken - 1];
+                    --taken;
+                }
+            }
+            return count;
+        }
+
+        // Replaces the contents with [first, last), which must be sorted with respect to Compare.
+        // Takes at most capacity() elements, returns the number taken.
+        template <typename InputIterator>
+        size_type assign_sorted(InputIterator first, InputIterator last)
+        {
+            clear();
+            return append(first, last);
+        }
+
         template <typename ValType>
         void replace_min(ValType &&val)
         {
@@ -166,7 +296,7 @@ namespace ulib
         void replace_max(ValType &&val)
         {
             data_.back() = std::forward<ValType>(val);
-            insertion_sort::restore_invariant_front(begin(), end(), *static_cast<Compare *>(this));
+            insertion_sort::restore_invariant_back(begin(), end(), *static_cast<Compare *>(this));
         }
 
         T &min_element()
@@ -209,6 +339,53 @@ namespace ulib
             return data_.end();
         }
 
+        // Ordered lookup: branchless binary search, finished by a SIMD count for arithmetic keys
+        // (see detail/sorted_search.hpp). Key may be any type Compare can compare with T both ways.
+        template <typename Key>
+        iterator lower_bound(const Key &key)
+        {
+            return begin() + (detail::sorted_lower_bound(data_.data(), data_.data() + size(), key, compare()) - data_.data());
+        }
+
+        template <typename Key>
+        const_iterator lower_bound(const Key &key) const
+        {
+            return detail::sorted_lower_bound(data_.data(), data_.data() + size(), key, compare());
+        }
+
+        template <typename Key>
+        iterator upper_bound(const Key &key)
+        {
+            return begin() + (detail::sorted_upper_bound(data_.data(), data_.data() + size(), key, compare()) - data_.data());
+        }
+
+        template <typename Key>
+        const_iterator upper_bound(const Key &key) const
+        {
+            return detail::sorted_upper_bound(data_.data(), data_.data() + size(), key, compare());
+        }
+
+        // Returns the first element equivalent to key, or end().
+        template <typename Key>
+        iterator find(const Key &key)
+        {
+            const iterator it = lower_bound(key);
+            return (it != end() && !compare()(key, *it)) ? it : end();
+        }
+
+        template <typename Key>
+        const_iterator find(const Key &key) const
+        {
+            const const_iterator it = lower_bound(key);
+            return (it != end() && !compare()(key, *it)) ? it : end();
+        }
+
+        template <typename Key>
+        bool contains(const Key &key) const
+        {
+            return find(key) != end();
+        }
+
         void erase(iterator it)
         {
             data_.erase(it);
@@ -256,6 +433,22 @@ namespace ulib
         }
 
       private:
+        const Compare &compare() const
+        {
+            return *static_cast<const Compare *>(this);
+        }
+
+        template <typename InputIterator>
+        size_type append(InputIterator first, InputIterator last)
+        {
+            size_type count = 0;
+            for (; first != last && data_.size() != data_.capacity(); ++first, ++count)
+            {
+                data_.emplace_back(*first);
+            }
+            return count;
+        }
+
         static_vector<T, Size> data_;
     };
 
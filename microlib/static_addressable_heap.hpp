@@ -0,0 +1,279 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MICROLIB_STATIC_ADDRESSABLE_HEAP_HPP__
+#define MICROLIB_STATIC_ADDRESSABLE_HEAP_HPP__
+
+#include <functional>
+#include <microlib/static_vector.hpp>
+#include <microlib/util.hpp>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+namespace ulib
+{
+
+    //
+    // Heap with static capacity of Size whose elements stay where they are: push() returns a handle
+    // that identifies the element until it is popped or erased, so update(), erase() and contains()
+    // need no search.
+    // Values live in fixed slots, the heap itself orders slot handles. A position map from handle to
+    // heap position is kept up to date by every sift.
+    // The handle array is a permutation of all slots: the first size() entries form the heap,
+    // the rest are the free slots, which makes push/erase bookkeeping O(1).
+    // Handles of removed elements get reused by later pushes.
+    //
+    template <typename T, size_t Size, typename Compare = std::less<T>, size_t Arity = 2>
+    class static_addressable_heap : public detail::ebo<Compare>
+    {
+        static_assert(Arity >= 2, "A heap needs at least two children per node.");
+
+      public:
+        using size_type = detail::auto_size_type_t<Size>;
+        // one wider than the slot indices need, so invalid_handle never collides with a slot
+        using handle = detail::auto_size_type_t<Size + 1>;
+
+        static constexpr handle invalid_handle = handle(-1);
+
+        static_addressable_heap(Compare compare = Compare()) : detail::ebo<Compare>(std::move(compare)), size_(0)
+        {
+            for (size_t i = 0; i < Size; ++i)
+            {
+                heap_[i] = handle(i);
+                position_[i] = size_type(i);
+            }
+        }
+
+        static_addressable_heap(const static_addressable_heap &) = delete;
+        static_addressable_heap &operator=(const static_addressable_heap &) = delete;
+
+        ~static_addressable_heap()
+        {
+            clear();
+        }
+
+        // Inserts a value into the heap.
+        // Returns invalid_handle iff there is not enough storage capacity left.
+        template <typename ValType>
+        handle push(ValType &&val)
+        {
+            return emplace(std::forward<ValType>(val));
+        }
+
+        // Inserts a value constructed in place from the given arguments.
+        // Returns invalid_handle iff there is not enough storage capacity left.
+        template <typename... Args>
+        handle emplace(Args &&... args)
+        {
+            if (size_ == Size)
+            {
+                return invalid_handle;
+            }
+
+            const handle h = heap_[size_];
+            new (&slots_[h]) T(std::forward<Args>(args)...);
+            sift_up(size_++);
+            return h;
+        }
+
+        // Removes the current top value. UB if the heap is empty.
+        void pop()
+        {
+            erase(heap_[0]);
+        }
+
+        // Removes the element with the given handle. UB if !contains(h).
+        void erase(handle h)
+        {
+            const size_t pos = position_[h];
+            value(h).~T();
+
+            // park h in the free area and fill its position with the last element
+            --size_;
+            place(pos, heap_[size_]);
+            place(size_, h);
+            if (pos != size_)
+            {
+                fix(pos);
+            }
+        }
+
+        // Restores the heap invariants after the value of the given element has been changed
+        // through get(). UB if !contains(h).
+        void update(handle h)
+        {
+            fix(position_[h]);
+        }
+
+        // Assigns a new value to the given element and restores the heap invariants.
+        template <typename ValType>
+        void update(handle h, ValType &&val)
+        {
+            value(h) = std::forward<ValType>(val);
+            fix(position_[h]);
+        }
+
+        // Returns true iff h refers to an element currently in the heap.
+        bool contains(handle h) const
+        {
+            return h < Size && position_[h] < size_;
+        }
+
+        // Access to an element by handle. Call update(h) after changing its ordering.
+        T &get(handle h)
+        {
+            return value(h);
+        }
+
+        const T &get(handle h) const
+        {
+            return value(h);
+        }
+
+        // Returns a reference to the current top value.
+        // UB if the heap is empty.
+        T &top_element()
+        {
+            return value(heap_[0]);
+        }
+
+        const T &top_element() const
+        {
+            return value(heap_[0]);
+        }
+
+        // Returns the handle of the current top value.
+        // UB if the heap is empty.
+        handle top_handle() const
+        {
+            return heap_[0];
+        }
+
+        size_type size() const
+        {
+            return size_;
+        }
+
+        constexpr size_type capacity() const
+        {
+            return Size;
+        }
+
+        void clear()
+        {
+            while (size_)
+            {
+                value(heap_[--size_]).~T();
+            }
+        }
+
+      private:
+        using slot_type = typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type;
+
+        T &value(handle h)
+        {
+            return *reinterpret_cast<T *>(&slots_[h]);
+        }
+
+        const T &value(handle h) const
+        {
+            return *reinterpret_cast<const T *>(&slots_[h]);
+        }
+
+        bool compare(handle a, handle b)
+        {
+            return static_cast<Compare *>(this)->operator()(value(a), value(b));
+        }
+
+        void place(size_t pos, handle h)
+        {
+            heap_[pos] = h;
+            position_[h] = size_type(pos);
+        }
+
+        static constexpr size_t parent(size_t pos)
+        {
+            return (pos - 1) / Arity;
+        }
+
+        static constexpr size_t first_child(size_t pos)
+        {
+            return pos * Arity + 1;
+        }
+
+        // only handles move, the values stay in their slots
+        size_t sift_up(size_t pos)
+        {
+            const handle h = heap_[pos];
+            while (pos > 0 && compare(h, heap_[parent(pos)]))
+            {
+                place(pos, heap_[parent(pos)]);
+                pos = parent(pos);
+            }
+            place(pos, h);
+            return pos;
+        }
+
+        void sift_down(size_t pos)
+        {
+            const handle h = heap_[pos];
+            while (first_child(pos) < size_)
+            {
+                const size_t last = min(first_child(pos) + Arity, size_t(size_));
+                size_t best = first_child(pos);
+                for (size_t child = best + 1; child < last; ++child)
+                {
+                    best = compare(heap_[child], heap_[best]) ? child : best;
+                }
+                if (!compare(heap_[best], h))
+                {
+                    break;
+                }
+
+                place(pos, heap_[best]);
+                pos = best;
+            }
+            place(pos, h);
+        }
+
+        // fixes the position of an element that was changed from outside
+        void fix(size_t pos)
+        {
+            if (sift_up(pos) == pos)
+            {
+                sift_down(pos);
+            }
+        }
+
+        size_type size_;
+        handle heap_[Size];
+        size_type position_[Size];
+        slot_type slots_[Size];
+
+#ifdef _DEBUG
+      public:
+        bool test_invariant()
+        {
+            for (size_t pos = 0; pos < Size; ++pos)
+            {
+                if (position_[heap_[pos]] != pos)
+                {
+                    return false;
+                }
+                if (pos != 0 && pos < size_ && compare(heap_[pos], heap_[parent(pos)]))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+#endif
+    };
+
+} // namespace ulib
+
+#endif
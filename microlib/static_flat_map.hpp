@@ -0,0 +1,428 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MICROLIB_STATIC_FLAT_MAP_HPP__
+#define MICROLIB_STATIC_FLAT_MAP_HPP__
+
+#include "detail/flat_storage.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <microlib/static_vector.hpp>
+#include <microlib/util.hpp>
+#include <type_traits>
+#include <utility>
+
+namespace ulib
+{
+
+    //
+    // Ordered map with unique keys and static capacity of Size, stored as a sorted array of keys and a parallel
+    // array of mapped values (structure of arrays). Searches only touch the dense key array, so small keys
+    // next to large values still pack a cache line each, and int/float keys get the SIMD search finish
+    // (see detail/sorted_search.hpp). Insertions and erasures shift both arrays behind the position.
+    // Lookups accept any key type Compare can compare with K both ways.
+    // Dereferencing an iterator yields std::pair<const K &, V &>, so for (auto [key, value] : map) works;
+    // there is no pair in memory to point to, so iterators have no operator->.
+    //
+    template <typename K, typename V, size_t Size, typename Compare = std::less<K>>
+    class static_flat_map : private detail::ebo<Compare>
+    {
+      public:
+        using key_type = K;
+        using mapped_type = V;
+        using size_type = size_t;
+
+        template <bool Const>
+        class basic_iterator
+        {
+            using map_type = typename std::conditional<Const, const static_flat_map, static_flat_map>::type;
+            using mapped_reference = typename std::conditional<Const, const V &, V &>::type;
+
+          public:
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type = std::pair<const K, V>;
+            using difference_type = std::ptrdiff_t;
+            using reference = std::pair<const K &, mapped_reference>;
+            using pointer = void;
+
+            basic_iterator() : map_(nullptr), index_(0)
+            {
+            }
+
+            basic_iterator(map_type *map, size_t index) : map_(map), index_(index)
+            {
+            }
+
+            // iterator to const_iterator
+            template <bool OtherConst, typename = typename std::enable_if<Const && !OtherConst>::type>
+            basic_iterator(const basic_iterator<OtherConst> &other) : map_(other.map_), index_(other.index_)
+            {
+            }
+
+            reference operator*() const
+            {
+                return reference(key(), value());
+            }
+
+            const K &key() const
+            {
+                return map_->keys_[index_];
+            }
+
+            mapped_reference value() const
+            {
+                return map_->values_[index_];
+            }
+
+            size_t index() const
+            {
+                return index_;
+            }
+
+            basic_iterator &operator++()
+            {
+                ++index_;
+                return *this;
+            }
+
+            basic_iterator operator++(int)
+            {
+                basic_iterator result(*this);
+                ++index_;
+                return result;
+            }
+
+            basic_iterator &operator--()
+            {
+                --index_;
+                return *this;
+            }
+
+            basic_iterator operator--(int)
+            {
+                basic_iterator result(*this);
+                --index_;
+                return result;
+            }
+
+            bool operator==(const basic_iterator &other) const
+            {
+                return index_ == other.index_;
+            }
+
+            bool operator!=(const basic_iterator &other) const
+            {
+                return index_ != other.index_;
+            }
+
+          private:
+            template <bool>
+            friend class basic_iterator;
+
+            map_type *map_;
+            size_t index_;
+        };
+
+        using iterator = basic_iterator<false>;
+        using const_iterator = basic_iterator<true>;
+
+        static_flat_map(Compare compare = Compare()) : detail::ebo<Compare>(std::move(compare))
+        {
+        }
+
+        // Builds the map from unsorted input, see assign().
+        template <typename InputIterator>
+        static_flat_map(InputIterator first, InputIterator last, Compare compare = Compare()) : detail::ebo<Compare>(std::move(compare))
+        {
+            assign(first, last);
+        }
+
+        static_flat_map(const static_flat_map &) = delete;
+        static_flat_map &operator=(const static_flat_map &) = delete;
+
+        ~static_flat_map()
+        {
+            clear();
+        }
+
+        // Replaces the contents with the (key, value) pairs of [first, last), in any order, in O(n log n):
+        // both arrays are filled as they come, an index permutation is sorted by key and then applied
+        // to both arrays in place, cycle by cycle. Of equivalent keys the first one is kept, like std::map does.
+        // Needs neither the heap nor stack space proportional to Size, the permutation lives in the map.
+        // Reads at most capacity() pairs, returns size().
+        template <typename InputIterator>
+        size_type assign(InputIterator first, InputIterator last)
+        {
+            clear();
+            for (; first != last && keys_.size() != keys_.capacity(); ++first)
+            {
+                keys_.emplace_back(first->first);
+                values_.emplace_back(first->second);
+            }
+
+            const size_t count = size();
+            for (size_t i = 0; i < count; ++i)
+            {
+                order_[i] = index_type(i);
+            }
+            // ties broken by position make std::sort stable, without the buffer std::stable_sort allocates
+            std::sort(order_, order_ + count, [&](index_type a, index_type b) {
+                return compare()(keys_[a], keys_[b]) || (!compare()(keys_[b], keys_[a]) && a < b);
+            });
+            permute(order_, count);
+
+            size_t unique = 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (unique == 0 || compare()(keys_[unique - 1], keys_[i]))
+                {
+                    if (unique != i)
+                    {
+                        keys_[unique] = std::move(keys_[i]);
+                        values_[unique] = std::move(values_[i]);
+                    }
+                    ++unique;
+                }
+            }
+            while (size() != unique)
+            {
+                keys_.pop_back();
+                values_.pop_back();
+            }
+            return size();
+        }
+
+        // Inserts a value constructed from args under key unless an equivalent key is present.
+        // Returns the key's position and true if it was inserted, false if the key was present
+        // (its position then, args are not touched) or the map is full (end() then).
+        template <typename KeyType, typename... Args>
+        std::pair<iterator, bool> try_emplace(KeyType &&key, Args &&... args)
+        {
+            const size_t index = detail::flat_lower_bound(keys_, key, compare());
+            if (index != size() && !compare()(key, keys_[index]))
+            {
+                return std::make_pair(iterator(this, index), false);
+            }
+            if (size() == capacity())
+            {
+                return std::make_pair(end(), false);
+            }
+            detail::flat_insert_at(keys_, index, std::forward<KeyType>(key));
+            detail::flat_insert_at(values_, index, std::forward<Args>(args)...);
+            return std::make_pair(iterator(this, index), true);
+        }
+
+        // Like try_emplace, but assigns val to the mapped value of a present key.
+        template <typename KeyType, typename ValType>
+        std::pair<iterator, bool> insert_or_assign(KeyType &&key, ValType &&val)
+        {
+            const size_t index = detail::flat_lower_bound(keys_, key, compare());
+            if (index != size() && !compare()(key, keys_[index]))
+            {
+                values_[index] = std::forward<ValType>(val);
+                return std::make_pair(iterator(this, index), false);
+            }
+            if (size() == capacity())
+            {
+                return std::make_pair(end(), false);
+            }
+            detail::flat_insert_at(keys_, index, std::forward<KeyType>(key));
+            detail::flat_insert_at(values_, index, std::forward<ValType>(val));
+            return std::make_pair(iterator(this, index), true);
+        }
+
+        // Returns the number of elements erased, 0 or 1.
+        template <typename Key>
+        size_type erase(const Key &key)
+        {
+            const size_t index = detail::flat_find(keys_, key, compare());
+            if (index == size())
+            {
+                return 0;
+            }
+            erase_at(index);
+            return 1;
+        }
+
+        // Returns the position following the erased element.
+        iterator erase(const_iterator where)
+        {
+            erase_at(where.index());
+            return iterator(this, where.index());
+        }
+
+        // keeps erase(key) from matching iterators
+        iterator erase(iterator where)
+        {
+            return erase(const_iterator(where));
+        }
+
+        template <typename Key>
+        iterator find(const Key &key)
+        {
+            return iterator(this, detail::flat_find(keys_, key, compare()));
+        }
+
+        template <typename Key>
+        const_iterator find(const Key &key) const
+        {
+            return const_iterator(this, detail::flat_find(keys_, key, compare()));
+        }
+
+        // Returns the mapped value of key, or nullptr.
+        template <typename Key>
+        V *get(const Key &key)
+        {
+            const size_t index = detail::flat_find(keys_, key, compare());
+            return index != size() ? &values_[index] : nullptr;
+        }
+
+        template <typename Key>
+        const V *get(const Key &key) const
+        {
+            const size_t index = detail::flat_find(keys_, key, compare());
+            return index != size() ? &values_[index] : nullptr;
+        }
+
+        template <typename Key>
+        bool contains(const Key &key) const
+        {
+            return detail::flat_find(keys_, key, compare()) != size();
+        }
+
+        template <typename Key>
+        iterator lower_bound(const Key &key)
+        {
+            return iterator(this, detail::flat_lower_bound(keys_, key, compare()));
+        }
+
+        template <typename Key>
+        const_iterator lower_bound(const Key &key) const
+        {
+            return const_iterator(this, detail::flat_lower_bound(keys_, key, compare()));
+        }
+
+        template <typename Key>
+        iterator upper_bound(const Key &key)
+        {
+            return iterator(this, detail::flat_upper_bound(keys_, key, compare()));
+        }
+
+        template <typename Key>
+        const_iterator upper_bound(const Key &key) const
+        {
+            return const_iterator(this, detail::flat_upper_bound(keys_, key, compare()));
+        }
+
+        iterator begin()
+        {
+            return iterator(this, 0);
+        }
+
+        iterator end()
+        {
+            return iterator(this, size());
+        }
+
+        const_iterator begin() const
+        {
+            return const_iterator(this, 0);
+        }
+
+        const_iterator end() const
+        {
+            return const_iterator(this, size());
+        }
+
+        // The sorted keys and their values, size() each.
+        const K *key_data() const
+        {
+            return keys_.data();
+        }
+
+        V *value_data()
+        {
+            return values_.data();
+        }
+
+        const V *value_data() const
+        {
+            return values_.data();
+        }
+
+        size_type size() const
+        {
+            return keys_.size();
+        }
+
+        bool empty() const
+        {
+            return keys_.size() == 0;
+        }
+
+        constexpr size_type capacity() const
+        {
+            return Size;
+        }
+
+        void clear()
+        {
+            keys_.clear();
+            values_.clear();
+        }
+
+      private:
+        using index_type = detail::auto_size_type_t<Size>;
+
+        const Compare &compare() const
+        {
+            return *static_cast<const Compare *>(this);
+        }
+
+        void erase_at(size_t index)
+        {
+            detail::flat_erase_at(keys_, index);
+            detail::flat_erase_at(values_, index);
+        }
+
+        // Rearranges both arrays so that element i is the one formerly at order[i]. Consumes order.
+        void permute(index_type *order, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (order[i] == i)
+                {
+                    continue;
+                }
+
+                K key(std::move(keys_[i]));
+                V value(std::move(values_[i]));
+                size_t hole = i;
+                while (order[hole] != i)
+                {
+                    const size_t next = order[hole];
+                    keys_[hole] = std::move(keys_[next]);
+                    values_[hole] = std::move(values_[next]);
+                    order[hole] = index_type(hole);
+                    hole = next;
+                }
+                keys_[hole] = std::move(key);
+                values_[hole] = std::move(value);
+                order[hole] = index_type(hole);
+            }
+        }
+
+        static_vector<K, Size> keys_;
+        static_vector<V, Size> values_;
+
+        // scratch space of assign()
+        index_type order_[Size > 0 ? Size : 1];
+    };
+
+} // namespace ulib
+
+#endif
@@ -0,0 +1,188 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MICROLIB_STATIC_FLAT_SET_HPP__
+#define MICROLIB_STATIC_FLAT_SET_HPP__
+
+#include "detail/flat_storage.hpp"
+#include "detail/inplace_merge.hpp"
+#include <algorithm>
+#include <functional>
+#include <microlib/static_vector.hpp>
+#include <microlib/util.hpp>
+#include <utility>
+
+namespace ulib
+{
+
+    //
+    // Ordered set of unique keys with static capacity of Size, stored as a sorted array.
+    // Lookups use the branchless binary search with SIMD finish of sorted_static_vector
+    // (see detail/sorted_search.hpp); insertions and erasures shift the keys behind the position.
+    // Lookups, insert and erase accept any key type Compare can compare with K both ways.
+    //
+    template <typename K, size_t Size, typename Compare = std::less<K>>
+    class static_flat_set : private detail::ebo<Compare>
+    {
+      public:
+        using key_type = K;
+        using value_type = K;
+        using size_type = size_t;
+        using iterator = const K *;
+        using const_iterator = const K *;
+
+        static_flat_set(Compare compare = Compare()) : detail::ebo<Compare>(std::move(compare))
+        {
+        }
+
+        // Builds the set from unsorted input, see assign().
+        template <typename InputIterator>
+        static_flat_set(InputIterator first, InputIterator last, Compare compare = Compare()) : detail::ebo<Compare>(std::move(compare))
+        {
+            assign(first, last);
+        }
+
+        static_flat_set(const static_flat_set &) = delete;
+        static_flat_set &operator=(const static_flat_set &) = delete;
+
+        ~static_flat_set()
+        {
+            clear();
+        }
+
+        // Replaces the contents with the keys of [first, last), in any order, without heap allocations:
+        // O(n log n) if the unused capacity, which serves as scratch space, holds n / 2 keys, somewhat more
+        // on a full set (see detail/inplace_merge.hpp).
+        // Of equivalent keys the first one is kept. Reads at most capacity() keys, returns size().
+        template <typename InputIterator>
+        size_type assign(InputIterator first, InputIterator last)
+        {
+            clear();
+            for (; first != last && keys_.size() != keys_.capacity(); ++first)
+            {
+                keys_.emplace_back(*first);
+            }
+
+            detail::stable_sort_in_place(keys_.begin(), keys_.end(), compare(), keys_.end(), size_t(keys_.capacity() - keys_.size()));
+            const size_t unique = size_t(std::unique(keys_.begin(), keys_.end(), [&](const K &a, const K &b) { return !compare()(a, b); }) -
+                                         keys_.begin());
+            while (size_t(keys_.size()) != unique)
+            {
+                keys_.pop_back();
+            }
+            return size();
+        }
+
+        // Returns the key's position and true if it was inserted, false if an equivalent key was present
+        // (its position then) or the set is full (end() then).
+        template <typename ValType>
+        std::pair<iterator, bool> insert(ValType &&key)
+        {
+            const size_t index = detail::flat_lower_bound(keys_, key, compare());
+            if (index != size() && !compare()(key, keys_[index]))
+            {
+                return std::make_pair(begin() + index, false);
+            }
+            if (size() == capacity())
+            {
+                return std::make_pair(end(), false);
+            }
+            detail::flat_insert_at(keys_, index, std::forward<ValType>(key));
+            return std::make_pair(begin() + index, true);
+        }
+
+        template <typename... Args>
+        std::pair<iterator, bool> emplace(Args &&... args)
+        {
+            return insert(K(std::forward<Args>(args)...));
+        }
+
+        // Returns the number of keys erased, 0 or 1.
+        template <typename Key>
+        size_type erase(const Key &key)
+        {
+            const size_t index = detail::flat_find(keys_, key, compare());
+            if (index == size())
+            {
+                return 0;
+            }
+            detail::flat_erase_at(keys_, index);
+            return 1;
+        }
+
+        // Returns the position following the erased key.
+        iterator erase(const_iterator where)
+        {
+            const size_t index = size_t(where - begin());
+            detail::flat_erase_at(keys_, index);
+            return begin() + index;
+        }
+
+        template <typename Key>
+        const_iterator find(const Key &key) const
+        {
+            return begin() + detail::flat_find(keys_, key, compare());
+        }
+
+        template <typename Key>
+        bool contains(const Key &key) const
+        {
+            return detail::flat_find(keys_, key, compare()) != size();
+        }
+
+        template <typename Key>
+        const_iterator lower_bound(const Key &key) const
+        {
+            return begin() + detail::flat_lower_bound(keys_, key, compare());
+        }
+
+        template <typename Key>
+        const_iterator upper_bound(const Key &key) const
+        {
+            return begin() + detail::flat_upper_bound(keys_, key, compare());
+        }
+
+        const_iterator begin() const
+        {
+            return keys_.begin();
+        }
+
+        const_iterator end() const
+        {
+            return keys_.end();
+        }
+
+        size_type size() const
+        {
+            return keys_.size();
+        }
+
+        bool empty() const
+        {
+            return keys_.size() == 0;
+        }
+
+        constexpr size_type capacity() const
+        {
+            return Size;
+        }
+
+        void clear()
+        {
+            keys_.clear();
+        }
+
+      private:
+        const Compare &compare() const
+        {
+            return *static_cast<const Compare *>(this);
+        }
+
+        static_vector<K, Size> keys_;
+    };
+
+} // namespace ulib
+
+#endif
@@ -6,7 +6,10 @@
 #ifndef MICROLIB_STATIC_HEAP_HPP__
 #define MICROLIB_STATIC_HEAP_HPP__
 
+#include "detail/calc.hpp"
+#include "detail/heap_simd.hpp"
 #include <functional>
+#include <iterator>
 #include <microlib/static_vector.hpp>
 #include <microlib/util.hpp>
 
@@ -19,13 +22,33 @@ namespace ulib
     // sift operations, thus we can implement the whole stuff...
     //
 
+    namespace detail
+    {
+
+        // Alignment making every group of Arity siblings start on its own cache line (or a fraction of one),
+        // provided the group size is a power of 2.
+        template <typename T, size_t Arity>
+        constexpr size_t heap_group_alignment()
+        {
+            return (Arity * sizeof(T) <= 64 && is_power_of_2(Arity * sizeof(T))) ? max(Arity * sizeof(T), alignof(T)) : alignof(T);
+        }
+
+    } // namespace detail
+
     // heap with static capacity of Size
     // stored types T must support move/copy construction and move/copy assignment.
-    template <typename T, size_t Size, typename Compare = std::less<T>>
+    // Arity is the number of children per node. A node's children are stored next to each other,
+    // and the storage is shifted by Arity - 1 slots, so the children groups start at multiples of Arity.
+    // Wider heaps are flatter and touch fewer cache lines per pop, at the cost of more compares per level.
+    // For arithmetic keys ordered by std::less/std::greater, 4-ary and 8-ary heaps pick the child
+    // with SIMD min/max instructions where the target supports them (see detail/heap_simd.hpp).
+    template <typename T, size_t Size, typename Compare = std::less<T>, size_t Arity = 2>
     struct static_heap : public detail::ebo<Compare>
     {
+        static_assert(Arity >= 2, "A heap needs at least two children per node.");
+
       public:
-        using container_type = static_vector<T, Size + 1, 1>;
+        using container_type = static_vector<T, Size + Arity - 1, Arity - 1>;
         using iterator = typename container_type::iterator;
         using const_iterator = typename container_type::const_iterator;
 
@@ -53,12 +76,50 @@ namespace ulib
             return emplace_back_and_sift_up(std::forward<Args>(args)...);
         }
 
+        // Replaces the contents with the elements of [first, last), built in O(n) (Floyd's method).
+        // Takes at most capacity() elements, returns the number taken.
+        template <typename InputIterator>
+        size_type assign(InputIterator first, InputIterator last)
+        {
+            data_.clear();
+            const size_type count = append(first, last);
+            make_heap();
+            return count;
+        }
+
+        // Inserts the elements of [first, last), either one by one or by rebuilding the whole heap,
+        // whichever needs fewer compares for the given sizes.
+        // Takes at most capacity() - size() elements, returns the number taken.
+        template <typename ForwardIterator>
+        size_type push_range(ForwardIterator first, ForwardIterator last)
+        {
+            const size_t batch = min(size_t(std::distance(first, last)), size_t(capacity() - size()));
+            if (detail::heap_rebuild_cheaper(size(), batch))
+            {
+                const size_type count = append(first, last);
+                make_heap();
+                return count;
+            }
+
+            for (size_t i = 0; i < batch; ++i, ++first)
+            {
+                push(*first);
+            }
+            return size_type(batch);
+        }
+
+        // Removes all elements.
+        void clear()
+        {
+            data_.clear();
+        }
+
         // Replaces the current top value with the given value, restoring
         // the heap invariants.
         template <typename ValType>
         void replace(ValType &&val)
         {
-            sift_up_move(sift_down_hole(root()), std::forward<ValType>(val));
+            sift_up(sift_down_hole(root()), std::forward<ValType>(val));
         }
 
         // Restores the heap invariants when they were broken by changing
@@ -73,9 +134,9 @@ namespace ulib
         void pop()
         {
             auto pos = sift_down_hole(root());
-            if (pos != data_.size())
+            if (pos != last())
             {
-                sift_up_move(pos, std::move(data_[data_.size()]));
+                sift_up_move(pos, std::move(data_[last()]));
             }
             data_.pop_back();
         }
@@ -136,24 +197,24 @@ namespace ulib
             return data_.capacity();
         }
 
+        // Removes the element pointed to by the given iterator, restoring the heap invariants.
         void erase(const_iterator it)
         {
-            const size_type idx = it - begin();
-            auto hole = sift_down_hole(idx);
-            if (hole != data_.size())
+            auto hole = sift_down_hole(it - begin() + root());
+            if (hole != last())
             {
-                sift_up_move(hole, std::move(data_[data_.size()]));
+                sift_up_move(hole, std::move(data_[last()]));
             }
             data_.pop_back();
         }
 
       private:
-        size_type sift_up_inplace(size_type index)
+        size_t sift_up_inplace(size_t index)
         {
             return sift_up(index, std::move(data_[index]));
         }
 
-        size_type sift_up(size_type hole, T val)
+        size_t sift_up(size_t hole, T val)
         {
             while (hole > root() && !compare(data_[parent(hole)], val))
             {
@@ -165,7 +226,7 @@ namespace ulib
             return hole;
         }
 
-        size_type sift_up_move(size_type hole, T &&val)
+        size_t sift_up_move(size_t hole, T &&val)
         {
             while (hole > root() && !compare(data_[parent(hole)], val))
             {
@@ -177,15 +238,15 @@ namespace ulib
             return hole;
         }
 
-        bool push_back_and_sift_up(T &&val)
+        bool push_back_and_sift_up(T val)
         {
             if (data_.size() != data_.capacity())
             {
                 // since we want to allow types which are not
                 // default-constructible, we need to know
                 // what belongs into the appended spot.
-                size_type index = parent(data_.size());
-                if (index != 0 && !compare(data_[index], val))
+                const size_t index = parent(last() + 1);
+                if (data_.size() != 0 && !compare(data_[index], val))
                 {
                     data_.emplace_back(std::move(data_[index]));
                     sift_up_move(index, std::move(val));
@@ -218,47 +279,83 @@ namespace ulib
 
         // returns true if the sift_up_operation had an effect
         // used by sift_fix only
-        bool sift_up_inplace_checked(size_type index)
+        bool sift_up_inplace_checked(size_t index)
         {
             return sift_up_inplace(index) != index;
         }
 
         // sifts down a value that is already resident in the heap
-        void sift_down_inplace(size_type index)
+        void sift_down_inplace(size_t index)
         {
             T val = std::move(data_[index]);
             sift_up_move(sift_down_hole(index), std::move(val));
         }
 
-        // sifts down a hole down to a leaf, returns final hole index
-        size_type sift_down_hole(size_type hole)
+        template <typename InputIterator>
+        size_type append(InputIterator first, InputIterator last)
         {
-            const auto s = data_.size();
-            while (lhs(hole) <= s)
+            size_type count = 0;
+            for (; first != last && data_.size() != data_.capacity(); ++first, ++count)
             {
-                if (rhs(hole) <= s && compare(data_[rhs(hole)], data_[lhs(hole)]))
+                data_.emplace_back(*first);
+            }
+            return count;
+        }
+
+        // establishes the heap invariants bottom-up, starting at the parent of the last element
+        void make_heap()
+        {
+            if (data_.size() > 1)
+            {
+                // sift_down_inplace() could climb above i into the part not yet built
+                for (size_t i = parent(last()) + 1; i-- > root();)
                 {
-                    data_[hole] = data_[rhs(hole)];
-                    hole = rhs(hole);
+                    T val = std::move(data_[i]);
+                    sift_down(i, std::move(val));
                 }
-                else
+            }
+        }
+
+        // returns the index of the preferred child among the siblings first..last
+        size_t best_child(size_t first, size_t last)
+        {
+            if constexpr (detail::heap_child_select<T, Arity, Compare>::enabled)
+            {
+                if (last - first == Arity - 1)
                 {
-                    data_[hole] = data_[lhs(hole)];
-                    hole = lhs(hole);
+                    return first + detail::heap_child_select<T, Arity, Compare>::select(&data_[first]);
                 }
             }
+
+            size_t best = first;
+            for (size_t child = first + 1; child <= last; ++child)
+            {
+                // written as a select, so simple keys compile to conditional moves instead of unpredictable branches
+                best = compare(data_[child], data_[best]) ? child : best;
+            }
+            return best;
+        }
+
+        // sifts down a hole down to a leaf, returns final hole index
+        size_t sift_down_hole(size_t hole)
+        {
+            const size_t s = last();
+            while (first_child(hole) <= s)
+            {
+                const size_t child = best_child(first_child(hole), min(first_child(hole) + Arity - 1, s));
+                data_[hole] = std::move(data_[child]);
+                hole = child;
+            }
             return hole;
         }
 
         // sifts down an external value
-        void sift_down(size_type hole, T val)
+        void sift_down(size_t hole, T val)
         {
-            const auto s = data_.size();
-            while (lhs(hole) <= s)
+            const size_t s = last();
+            while (first_child(hole) <= s)
             {
-                auto next_child = lhs(hole);
-                if (rhs(hole) <= s && !compare(data_[lhs(hole)], data_[rhs(hole)]))
-                    next_child = rhs(hole);
+                const size_t next_child = best_child(first_child(hole), min(first_child(hole) + Arity - 1, s));
                 if (compare(val, data_[next_child]))
                     break;
 
@@ -269,7 +366,7 @@ namespace ulib
         }
 
         // fixes the position of a node that was changed from outside
-        void sift_fix(size_type i)
+        void sift_fix(size_t i)
         {
             if (!sift_up_inplace_checked(i))
             {
@@ -282,28 +379,32 @@ namespace ulib
             return static_cast<Compare *>(this)->operator()(a, b);
         }
 
-        static constexpr size_type parent(size_type idx)
+        // Indices address the container directly. With Base = Arity - 1 the root sits at Arity - 1
+        // and the children of node i at Arity * (i - Arity + 2) ... + Arity - 1;
+        // for Arity == 2 this is the classic one-based layout.
+        static constexpr size_t parent(size_t idx)
         {
-            return idx / 2;
+            return idx / Arity + Arity - 2;
         }
 
-        static constexpr size_type lhs(size_type idx)
+        static constexpr size_t first_child(size_t idx)
         {
-            return idx * 2;
+            return Arity * (idx + 2 - Arity);
         }
 
-        static constexpr size_type rhs(size_type idx)
+        static constexpr size_t root()
         {
-            return idx * 2 + 1;
+            return Arity - 1;
         }
 
-        static constexpr size_type root()
+        // index of the last element
+        size_t last() const
         {
-            return 1;
+            return data_.size() + Arity - 2;
         }
 
       private:
-        container_type data_;
+        alignas(detail::heap_group_alignment<T, Arity>()) container_type data_;
 
 #ifdef _DEBUG
       public:
@@ -319,15 +420,14 @@ namespace ulib
 
         bool test_invariant()
         {
-            for (size_type i = root(); i <= data_.size(); ++i)
+            for (size_t i = root(); i <= last(); ++i)
             {
-                if (lhs(i) <= data_.size() && !less_equal(data_[i], data_[lhs(i)]))
+                for (size_t child = first_child(i); child < first_child(i) + Arity && child <= last(); ++child)
                 {
-                    return false;
-                }
-                if (rhs(i) <= data_.size() && !less_equal(data_[i], data_[rhs(i)]))
-                {
-                    return false;
+                    if (!less_equal(data_[i], data_[child]))
+                    {
+                        return false;
+                    }
                 }
             }
             return true;
@@ -335,6 +435,9 @@ namespace ulib
 #endif
     };
 
+    template <typename T, size_t Size, size_t Arity, typename Compare = std::less<T>>
+    using static_dary_heap = static_heap<T, Size, Compare, Arity>;
+
 } // namespace ulib
 
 #endif
@@ -6,7 +6,9 @@
 #ifndef MICROLIB_STATIC_INTERVAL_HEAP_HPP__
 #define MICROLIB_STATIC_INTERVAL_HEAP_HPP__
 
+#include "detail/calc.hpp"
 #include <functional>
+#include <iterator>
 #include <microlib/static_vector.hpp>
 #include <microlib/util.hpp>
 
@@ -68,12 +70,7 @@ namespace ulib
 
         void pop_min()
         {
-            auto pos = sift_down_hole_min(1);
-            if (index(pos, 0) != (data_.size() + 1))
-            {
-                sift_up(pos, 0, std::move(data_[data_.size() + 1]));
-            }
-            data_.pop_back();
+            fill_hole_and_pop(sift_down_hole_min(1), 0);
         }
 
         void pop_max()
@@ -84,12 +81,7 @@ namespace ulib
             }
             else
             {
-                auto pos = sift_down_hole_max(1);
-                if (index(pos, 1) != (data_.size() + 1))
-                {
-                    sift_up(pos, 1, std::move(data_[data_.size() + 1]));
-                }
-                data_.pop_back();
+                fill_hole_and_pop(sift_down_hole_max(1), 1);
             }
         }
 
@@ -97,7 +89,21 @@ namespace ulib
         template <typename ValType>
         void replace_max(ValType &&val)
         {
-            sift_up(sift_down_hole_max(1), 1, std::forward<ValType>(val));
+            if (size() == 1)
+            {
+                // a single element sits on the min side
+                replace_min(std::forward<ValType>(val));
+            }
+            else
+            {
+                // the hole based sift would miss a single element last node below the max side
+                T max_val(std::forward<ValType>(val));
+                if (compare(max_val, element(1, 0)))
+                {
+                    std::swap(max_val, element(1, 0));
+                }
+                sift_down_max(1, std::move(max_val));
+            }
         }
 
         template <typename ValType>
@@ -109,68 +115,52 @@ namespace ulib
         template <typename ValType>
         bool push(ValType &&val)
         {
-            // This is more complicated than it needs to be, beca�se
-            // we're trying hard to avoid to default-initialize the
-            // new element inside the array.
-
-            if (!data_.size())
+            if (data_.size() != data_.capacity())
             {
-                data_.emplace_back(std::forward<ValType>(val));
+                insert(std::forward<ValType>(val));
                 return true;
             }
-            else if (data_.size() != data_.capacity())
+            else
             {
-                const auto vindex = (data_.size() + 2) / 2;
-                const unsigned char side = data_.size() % 2;
+                return false;
+            }
+        }
 
-                if (side == 1)
-                {
-                    if (!compare(data_[index(vindex, 0)], val))
-                    {
-                        // move left to right
-                        data_.emplace_back(std::move(element(vindex, 0)));
-                        sift_up(vindex, 0, std::forward<ValType>(val));
-                    }
-                    else
-                    {
-                        // hole was in right side (extending an existing node)
-                        if (vindex != 1 && compare(element(parent(vindex), 1), val))
-                        {
-                            data_.emplace_back(std::move(element(parent(vindex), 1)));
-                            sift_up(parent(vindex), 1, std::forward<ValType>(val));
-                        }
-                        else
-                        {
-                            data_.emplace_back(std::forward<ValType>(val));
-                        }
-                    }
-                }
-                else
-                {
-                    // hole in left side (we're creating a new node)
-                    // side == 0
-                    // since size was not 0, we must have a parent
-                    if (!compare(element(parent(vindex), 0), val))
-                    {
-                        data_.emplace_back(std::move(element(parent(vindex), 0)));
-                        sift_up(parent(vindex), 0, std::forward<ValType>(val));
-                    }
-                    else if (compare(element(parent(vindex), 1), val))
-                    {
-                        data_.emplace_back(std::move(element(parent(vindex), 1)));
-                        sift_up(parent(vindex), 1, std::forward<ValType>(val));
-                    }
-                    else
-                    {
-                        data_.emplace_back(std::forward<ValType>(val));
-                    }
-                }
-                return true;
+        // Replaces the contents with the elements of [first, last), built in O(n) bottom-up.
+        // Takes at most capacity() elements, returns the number taken.
+        template <typename InputIterator>
+        size_type assign(InputIterator first, InputIterator last)
+        {
+            data_.clear();
+            const size_type count = append(first, last);
+            make_heap();
+            return count;
+        }
+
+        // Inserts the elements of [first, last), either one by one or by rebuilding the whole heap,
+        // whichever needs fewer compares for the given sizes.
+        // Takes at most capacity() - size() elements, returns the number taken.
+        template <typename ForwardIterator>
+        size_type push_range(ForwardIterator first, ForwardIterator last)
+        {
+            const size_t batch = min(size_t(std::distance(first, last)), size_t(capacity() - size()));
+            if (detail::heap_rebuild_cheaper(size(), batch))
+            {
+                const size_type count = append(first, last);
+                make_heap();
+                return count;
             }
-            else
+
+            for (size_t i = 0; i < batch; ++i, ++first)
             {
-                return false;
+                push(*first);
             }
+            return size_type(batch);
+        }
+
+        void clear()
+        {
+            data_.clear();
         }
 
         template <typename... Args>
@@ -178,12 +168,16 @@ namespace ulib
         {
             if (!data_.size())
             {
-                data_.emplace_back(std::forward<Args>(args)...);
+                return data_.emplace_back(std::forward<Args>(args)...);
             }
             else if (data_.size() != data_.capacity())
             {
                 return push(T(std::forward<Args>(args)...));
             }
+            else
+            {
+                return false;
+            }
         }
 
         // iterator interface
@@ -208,13 +202,15 @@ namespace ulib
             return data_.end();
         }
 
+        // Call this if you changed the ordering of the given element.
+        // The element is taken out and inserted again: a changed value may have to move down one side
+        // and the node's other element up the other, so a single sift is not enough.
+        // Returns the element's new position.
         iterator restore(iterator where)
         {
-            size_type idx = where - begin() + 2;
-            unsigned char side = idx % 2;
-            T val(std::move(data_[idx]));
-            idx = sift_up(sift_down_hole(idx / 2, side), side, std::move(val));
-            return begin() + (idx - 2);
+            T val(std::move(*where));
+            erase(where);
+            return begin() + (insert(std::move(val)) - 2);
         }
 
         void erase(iterator where)
@@ -222,14 +218,159 @@ namespace ulib
             size_type idx = where - begin() + 2;
             unsigned char side = idx % 2;
 
-            idx = sift_down_hole(idx / 2, side);
+            fill_hole_and_pop(sift_down_hole(idx / 2, side), side);
+        }
 
-            if (index(idx, side) != data_.size() + 1)
+      private:
+        // Returns the storage index val ended up at. There must be room left.
+        template <typename ValType>
+        size_type insert(ValType &&val)
+        {
+            // This is more complicated than it needs to be, because
+            // we're trying hard to avoid to default-initialize the
+            // new element inside the array.
+
+            if (!data_.size())
             {
-                sift_up(idx, side, std::move(data_.size() + 1));
+                data_.emplace_back(std::forward<ValType>(val));
+                return index(1, 0);
             }
 
-            data_.pop_back();
+            const auto vindex = (data_.size() + 2) / 2;
+            const unsigned char side = data_.size() % 2;
+
+            if (side == 1)
+            {
+                if (!compare(data_[index(vindex, 0)], val))
+                {
+                    // move left to right
+                    data_.emplace_back(std::move(element(vindex, 0)));
+                    return sift_up(vindex, 0, std::forward<ValType>(val));
+                }
+                // hole was in right side (extending an existing node)
+                if (vindex != 1 && compare(element(parent(vindex), 1), val))
+                {
+                    data_.emplace_back(std::move(element(parent(vindex), 1)));
+                    return sift_up(parent(vindex), 1, std::forward<ValType>(val));
+                }
+            }
+            else
+            {
+                // hole in left side (we're creating a new node)
+                // since size was not 0, we must have a parent
+                if (!compare(element(parent(vindex), 0), val))
+                {
+                    data_.emplace_back(std::move(element(parent(vindex), 0)));
+                    return sift_up(parent(vindex), 0, std::forward<ValType>(val));
+                }
+                if (compare(element(parent(vindex), 1), val))
+                {
+                    data_.emplace_back(std::move(element(parent(vindex), 1)));
+                    return sift_up(parent(vindex), 1, std::forward<ValType>(val));
+                }
+            }
+
+            data_.emplace_back(std::forward<ValType>(val));
+            return index(vindex, side);
+        }
+
+        template <typename InputIterator>
+        size_type append(InputIterator first, InputIterator last)
+        {
+            size_type count = 0;
+            for (; first != last && data_.size() != data_.capacity(); ++first, ++count)
+            {
+                data_.emplace_back(*first);
+            }
+            return count;
+        }
+
+        // Bottom-up construction: orders every node's pair, then sifts its min down the min side
+        // and its max down the max side. Only the last node can lack a max, and it has no children.
+        void make_heap()
+        {
+            const size_t last = size() + 1;
+            for (size_t vindex = last / 2; vindex >= 1; --vindex)
+            {
+                const bool has_max = index(vindex, 1) <= last;
+                if (has_max && compare(element(vindex, 1), element(vindex, 0)))
+                {
+                    std::swap(element(vindex, 0), element(vindex, 1));
+                }
+
+                if (index(lhs(vindex), 0) <= last)
+                {
+                    T min_val(std::move(element(vindex, 0)));
+                    sift_down_min(vindex, std::move(min_val));
+                    T max_val(std::move(element(vindex, 1)));
+                    sift_down_max(vindex, std::move(max_val));
+                }
+            }
+        }
+
+        // Sifts val down the min side from vindex, where val is not larger than the max of vindex.
+        // Whenever val exceeds the max of the node it arrives at, the two are exchanged.
+        void sift_down_min(size_t vindex, T val)
+        {
+            const size_t last = size() + 1;
+            while (index(lhs(vindex), 0) <= last)
+            {
+                size_t child = lhs(vindex);
+                if (index(rhs(vindex), 0) <= last && compare(element(rhs(vindex), 0), element(child, 0)))
+                {
+                    child = rhs(vindex);
+                }
+                if (!compare(element(child, 0), val))
+                {
+                    break;
+                }
+
+                element(vindex, 0) = std::move(element(child, 0));
+                vindex = child;
+                if (index(vindex, 1) <= last && compare(element(vindex, 1), val))
+                {
+                    std::swap(val, element(vindex, 1));
+                }
+            }
+            element(vindex, 0) = std::move(val);
+        }
+
+        // Mirror image of sift_down_min on the max side.
+        void sift_down_max(size_t vindex, T val)
+        {
+            const size_t last = size() + 1;
+            while (index(lhs(vindex), 0) <= last)
+            {
+                // a child without max (the last node) takes part with its min
+                size_t child = lhs(vindex);
+                size_t child_side = index(child, 1) <= last ? 1 : 0;
+                if (index(rhs(vindex), 0) <= last)
+                {
+                    const size_t rhs_side = index(rhs(vindex), 1) <= last ? 1 : 0;
+                    if (compare(element(child, child_side), element(rhs(vindex), rhs_side)))
+                    {
+                        child = rhs(vindex);
+                        child_side = rhs_side;
+                    }
+                }
+                if (!compare(val, element(child, child_side)))
+                {
+                    break;
+                }
+
+                element(vindex, 1) = std::move(element(child, child_side));
+                vindex = child;
+                if (child_side == 0)
+                {
+                    // single element leaf, val takes its place
+                    break;
+                }
+                if (compare(val, element(vindex, 0)))
+                {
+                    std::swap(val, element(vindex, 0));
+                }
+            }
+            element(vindex, index(vindex, 1) <= last ? 1 : 0) = std::move(val);
         }
 
       private:
@@ -285,12 +426,38 @@ namespace ulib
             }
         }
 
-        size_type sift_up(size_type vindex, unsigned char side, T value)
+        // Fills the hole left by sift_down_hole with the last element and drops the last slot.
+        // If the last element shares the hole's node it just changes sides, sift_up would read it after the move.
+        void fill_hole_and_pop(size_type vindex, unsigned char side)
         {
-            if (!invariant(value, element(vindex, side ^ 1), side))
+            const size_t last = size() + 1;
+            if (index(vindex, side ^ 1) == last)
             {
                 element(vindex, side) = std::move(element(vindex, side ^ 1));
-                side = side ^ 1;
+            }
+            else if (index(vindex, side) != last)
+            {
+                sift_up(vindex, side, std::move(data_[last]));
+            }
+            data_.pop_back();
+        }
+
+        size_type sift_up(size_type vindex, unsigned char side, T value)
+        {
+            if (index(vindex, side ^ 1) <= size() + 1)
+            {
+                if (!invariant(value, element(vindex, side ^ 1), side))
+                {
+                    element(vindex, side) = std::move(element(vindex, side ^ 1));
+                    side = side ^ 1;
+                }
+            }
+            else if (vindex != 1 && compare(element(parent(vindex), 1), value))
+            {
+                // a single element in the last node is bounded by both sides of the parent
+                element(vindex, side) = std::move(element(parent(vindex), 1));
+                vindex = parent(vindex);
+                side = 1;
             }
 
             while (vindex != 1 && !invariant(element(parent(vindex), side), value, side))
@@ -353,6 +520,34 @@ namespace ulib
 
       private:
         storage_type data_;
+
+#ifdef _DEBUG
+      public:
+        bool test_invariant()
+        {
+            const size_t last = size() + 1;
+            for (size_t vindex = 1; index(vindex, 0) <= last; ++vindex)
+            {
+                const bool has_max = index(vindex, 1) <= last;
+                if (has_max && compare(element(vindex, 1), element(vindex, 0)))
+                {
+                    return false;
+                }
+                if (vindex != 1)
+                {
+                    for (size_t side = 0; side < (has_max ? 2u : 1u); ++side)
+                    {
+                        if (compare(element(vindex, side), element(parent(vindex), 0)) ||
+                            compare(element(parent(vindex), 1), element(vindex, side)))
+                        {
+                            return false;
+                        }
+                    }
+                }
+            }
+            return true;
+        }
+#endif
     };
 
 } // namespace ulib
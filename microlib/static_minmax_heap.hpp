@@ -0,0 +1,398 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MICROLIB_STATIC_MINMAX_HEAP_HPP__
+#define MICROLIB_STATIC_MINMAX_HEAP_HPP__
+
+#include "detail/calc.hpp"
+#include <functional>
+#include <iterator>
+#include <microlib/static_vector.hpp>
+#include <microlib/util.hpp>
+#include <utility>
+
+namespace ulib
+{
+
+    //
+    // Double ended priority queue with static capacity of Size (min-max heap, M. D. Atkinson et al.).
+    // A binary heap whose levels alternate between min and max levels: every element on an even level
+    // is the smallest of its subtree, every element on an odd level the largest.
+    // The minimum is the root, the maximum one of its two children.
+    // Unlike static_inverval_heap it stores single elements, so it needs no pairing step and the
+    // elements stay contiguous; pops look at up to four grandchildren per step but descend two levels at once.
+    // Storage is 1-based (root at index 1), which makes parents, children and level parity bit operations.
+    //
+    template <typename T, size_t Size, typename Compare = std::less<T>>
+    class static_minmax_heap : public detail::ebo<Compare>
+    {
+      public:
+        using storage_type = static_vector<T, Size + 1, 1>;
+        using size_type = typename storage_type::size_type;
+
+        using iterator = typename storage_type::iterator;
+        using const_iterator = typename storage_type::const_iterator;
+
+        static_minmax_heap(Compare comp = Compare()) : detail::ebo<Compare>(std::move(comp))
+        {
+        }
+
+      public:
+        // UB if the heap is empty.
+        const T &min_element() const
+        {
+            return data_[1];
+        }
+
+        T &min_element()
+        {
+            return data_[1];
+        }
+
+        // UB if the heap is empty.
+        const T &max_element() const
+        {
+            return data_[max_index()];
+        }
+
+        T &max_element()
+        {
+            return data_[max_index()];
+        }
+
+        size_type size() const
+        {
+            return data_.size();
+        }
+
+        size_type capacity() const
+        {
+            return data_.capacity();
+        }
+
+        // Returns false iff there is not enough storage capacity left.
+        template <typename ValType>
+        bool push(ValType &&val)
+        {
+            return emplace(std::forward<ValType>(val));
+        }
+
+        template <typename... Args>
+        bool emplace(Args &&... args)
+        {
+            if (data_.size() == data_.capacity())
+            {
+                return false;
+            }
+
+            data_.emplace_back(std::forward<Args>(args)...);
+            if (size() > 1)
+            {
+                T val(std::move(data_[size()]));
+                fix(size(), std::move(val));
+            }
+            return true;
+        }
+
+        // UB if the heap is empty.
+        void pop_min()
+        {
+            remove(1);
+        }
+
+        // UB if the heap is empty.
+        void pop_max()
+        {
+            remove(max_index());
+        }
+
+        // Replaces the minimum or maximum respectively by val. UB if the heap is empty.
+        template <typename ValType>
+        void replace_min(ValType &&val)
+        {
+            fix(1, T(std::forward<ValType>(val)));
+        }
+
+        template <typename ValType>
+        void replace_max(ValType &&val)
+        {
+            fix(max_index(), T(std::forward<ValType>(val)));
+        }
+
+        // Replaces the contents with the elements of [first, last), built in O(n) bottom-up.
+        // Takes at most capacity() elements, returns the number taken.
+        template <typename InputIterator>
+        size_type assign(InputIterator first, InputIterator last)
+        {
+            data_.clear();
+            const size_type count = append(first, last);
+            make_heap();
+            return count;
+        }
+
+        // Inserts the elements of [first, last), either one by one or by rebuilding the whole heap,
+        // whichever needs fewer compares for the given sizes.
+        // Takes at most capacity() - size() elements, returns the number taken.
+        template <typename ForwardIterator>
+        size_type push_range(ForwardIterator first, ForwardIterator last)
+        {
+            const size_t batch = min(size_t(std::distance(first, last)), size_t(capacity() - size()));
+            if (detail::heap_rebuild_cheaper(size(), batch))
+            {
+                const size_type count = append(first, last);
+                make_heap();
+                return count;
+            }
+
+            for (size_t i = 0; i < batch; ++i, ++first)
+            {
+                push(*first);
+            }
+            return size_type(batch);
+        }
+
+        void clear()
+        {
+            data_.clear();
+        }
+
+        // iterator interface
+      public:
+        iterator begin()
+        {
+            return data_.begin();
+        }
+
+        const_iterator begin() const
+        {
+            return data_.begin();
+        }
+
+        iterator end()
+        {
+            return data_.end();
+        }
+
+        const_iterator end() const
+        {
+            return data_.end();
+        }
+
+        // Call this if you changed the ordering of the given element.
+        // Returns the element's new position.
+        iterator restore(iterator where)
+        {
+            const size_t idx = size_t(where - begin()) + 1;
+            T val(std::move(data_[idx]));
+            return begin() + (fix(idx, std::move(val)) - 1);
+        }
+
+        void erase(iterator where)
+        {
+            remove(size_t(where - begin()) + 1);
+        }
+
+      private:
+        static constexpr size_t even_bits = size_t(0x5555555555555555ull);
+
+        // level parity: the highest set bit of a 1-based index is on an even position iff it is on a min level
+        static constexpr bool is_min_level(size_t idx)
+        {
+            return (idx & even_bits) > (idx & ~even_bits);
+        }
+
+        size_t max_index() const
+        {
+            if (size() < 3)
+            {
+                return size();
+            }
+            return compare(data_[2], data_[3]) ? 3 : 2;
+        }
+
+        template <bool Max>
+        bool ordered(const T &a, const T &b) const
+        {
+            return Max ? compare(b, a) : compare(a, b);
+        }
+
+        bool compare(const T &a, const T &b) const
+        {
+            return static_cast<const Compare *>(this)->operator()(a, b);
+        }
+
+        // removes the element at idx, the last element takes its place
+        void remove(size_t idx)
+        {
+            const size_t last = size();
+            if (idx != last)
+            {
+                T val(std::move(data_[last]));
+                data_.pop_back();
+                fix(idx, std::move(val));
+            }
+            else
+            {
+                data_.pop_back();
+            }
+        }
+
+        // Puts val into the hole at idx, where it may be out of order both ways.
+        // Returns the final position of val.
+        size_t fix(size_t idx, T val)
+        {
+            return is_min_level(idx) ? fix_level<false>(idx, std::move(val)) : fix_level<true>(idx, std::move(val));
+        }
+
+        // idx is on a min level for Max == false, on a max level otherwise
+        template <bool Max>
+        size_t fix_level(size_t idx, T val)
+        {
+            const size_t parent = idx / 2;
+            if (idx > 1 && ordered<!Max>(val, data_[parent]))
+            {
+                // val is beyond the parent, which in turn is beyond everything below idx:
+                // val climbs from the parent, and the parent's element fills idx from below
+                T displaced(std::move(data_[parent]));
+                const size_t pos = sift_up_levels<!Max>(parent, std::move(val));
+                trickle_down<Max>(idx, std::move(displaced));
+                return pos;
+            }
+            if (idx > 3 && ordered<Max>(val, data_[idx / 4]))
+            {
+                return sift_up_levels<Max>(idx, std::move(val));
+            }
+            return trickle_down<Max>(idx, std::move(val));
+        }
+
+        template <bool Max>
+        size_t sift_up_levels(size_t idx, T val)
+        {
+            while (idx > 3 && ordered<Max>(val, data_[idx / 4]))
+            {
+                data_[idx] = std::move(data_[idx / 4]);
+                idx /= 4;
+            }
+            data_[idx] = std::move(val);
+            return idx;
+        }
+
+        // Moves val down from the hole at idx (a min level for Max == false, a max level otherwise),
+        // two levels per step. Whenever val passes the opposite kind of element on the level in between,
+        // the two are exchanged and the exchanged element continues.
+        // Returns the final position of the original val.
+        template <bool Max>
+        size_t trickle_down(size_t idx, T val)
+        {
+            const size_t last = size();
+            size_t origin = 0;
+            while (2 * idx <= last)
+            {
+                const size_t first_grandchild = 4 * idx;
+                size_t best;
+                if (first_grandchild + 3 <= last)
+                {
+                    // all grandchildren present: the children are beaten by their own children anyway
+                    const size_t left = ordered<Max>(data_[first_grandchild + 1], data_[first_grandchild]) ? first_grandchild + 1 : first_grandchild;
+                    const size_t right =
+                        ordered<Max>(data_[first_grandchild + 3], data_[first_grandchild + 2]) ? first_grandchild + 3 : first_grandchild + 2;
+                    best = ordered<Max>(data_[right], data_[left]) ? right : left;
+                }
+                else
+                {
+                    // best among the children and grandchildren
+                    best = 2 * idx;
+                    if (best + 1 <= last && ordered<Max>(data_[best + 1], data_[best]))
+                    {
+                        best = best + 1;
+                    }
+                    for (size_t g = first_grandchild; g <= last; ++g)
+                    {
+                        if (ordered<Max>(data_[g], data_[best]))
+                        {
+                            best = g;
+                        }
+                    }
+                }
+
+                if (!ordered<Max>(data_[best], val))
+                {
+                    break;
+                }
+
+                data_[idx] = std::move(data_[best]);
+                idx = best;
+                if (best < first_grandchild)
+                {
+                    // a child of the opposite kind, val is beyond everything below it
+                    break;
+                }
+                if (ordered<Max>(data_[best / 2], val))
+                {
+                    std::swap(val, data_[best / 2]);
+                    origin = origin ? origin : best / 2;
+                }
+            }
+            data_[idx] = std::move(val);
+            return origin ? origin : idx;
+        }
+
+        template <typename InputIterator>
+        size_type append(InputIterator first, InputIterator last)
+        {
+            size_type count = 0;
+            for (; first != last && data_.size() != data_.capacity(); ++first, ++count)
+            {
+                data_.emplace_back(*first);
+            }
+            return count;
+        }
+
+        // Floyd's method: trickle down every inner element, last one first.
+        // The subtrees below are valid heaps already, and nothing above is looked at.
+        void make_heap()
+        {
+            for (size_t idx = size() / 2; idx >= 1; --idx)
+            {
+                T val(std::move(data_[idx]));
+                if (is_min_level(idx))
+                {
+                    trickle_down<false>(idx, std::move(val));
+                }
+                else
+                {
+                    trickle_down<true>(idx, std::move(val));
+                }
+            }
+        }
+
+      private:
+        storage_type data_;
+
+#ifdef _DEBUG
+      public:
+        bool test_invariant() const
+        {
+            // every element against its parent and grandparent suffices
+            for (size_t idx = 2; idx <= min(size_t(size()), Size); ++idx)
+            {
+                const bool min_level = is_min_level(idx);
+                if (min_level ? compare(data_[idx / 2], data_[idx]) : compare(data_[idx], data_[idx / 2]))
+                {
+                    return false;
+                }
+                if (idx > 3 && (min_level ? compare(data_[idx], data_[idx / 4]) : compare(data_[idx / 4], data_[idx])))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+#endif
+    };
+
+} // namespace ulib
+
+#endif
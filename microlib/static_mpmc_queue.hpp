@@ -0,0 +1,185 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MICROLIB_STATIC_MPMC_QUEUE_HPP__
+#define MICROLIB_STATIC_MPMC_QUEUE_HPP__
+
+#include "detail/calc.hpp"
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace ulib
+{
+
+    //
+    // Bounded multi-producer/multi-consumer FIFO with a power-of-2 capacity, like static_deque.
+    // Every slot carries a sequence number telling whose turn it is (D. Vyukov's bounded MPMC queue):
+    // slot i is free for the producer holding ticket p iff sequence == p and filled for the consumer
+    // holding ticket c iff sequence == c + 1. Producers and consumers only contend on their own ticket
+    // counter, each of which lives on its own cache line.
+    //
+    template <typename Type, size_t Capacity>
+    class static_mpmc_queue
+    {
+        static_assert(ulib::detail::is_power_of_2(Capacity), "Capacity must be a power of 2.");
+
+      public:
+        static_mpmc_queue()
+        {
+            for (size_t i = 0; i < Capacity; ++i)
+            {
+                cells_[i].sequence_.store(i, std::memory_order_relaxed);
+            }
+            enqueue_pos_.store(0, std::memory_order_relaxed);
+            dequeue_pos_.store(0, std::memory_order_relaxed);
+        }
+
+        static_mpmc_queue(const static_mpmc_queue &) = delete;
+        static_mpmc_queue &operator=(const static_mpmc_queue &) = delete;
+
+        ~static_mpmc_queue()
+        {
+            const size_t end = enqueue_pos_.load(std::memory_order_relaxed);
+            for (size_t pos = dequeue_pos_.load(std::memory_order_relaxed); pos != end; ++pos)
+            {
+                reinterpret_cast<Type *>(&cells_[pos & mask].data_)->~Type();
+            }
+        }
+
+        constexpr size_t capacity() const
+        {
+            return Capacity;
+        }
+
+        // Approximate while other threads are pushing or popping.
+        size_t size_approx() const
+        {
+            return enqueue_pos_.load(std::memory_order_relaxed) - dequeue_pos_.load(std::memory_order_relaxed);
+        }
+
+        // Returns false iff the queue is full.
+        bool try_push(Type val)
+        {
+            size_t pos;
+            if (!claim(enqueue_pos_, 0, 1, pos))
+            {
+                return false;
+            }
+
+            construct(pos, std::move(val));
+            return true;
+        }
+
+        // Returns false iff the queue is empty.
+        bool try_pop(Type &val)
+        {
+            size_t pos;
+            if (!claim(dequeue_pos_, 1, 1, pos))
+            {
+                return false;
+            }
+
+            val = take(pos);
+            return true;
+        }
+
+        // Pushes up to n elements from first on with a single ticket claim.
+        // Returns the number of elements pushed, which is less than n only if the queue ran full.
+        template <typename Iterator>
+        size_t try_push_n(Iterator first, size_t n)
+        {
+            size_t pos;
+            const size_t count = claim(enqueue_pos_, 0, n, pos);
+            for (size_t i = 0; i < count; ++i, ++first)
+            {
+                construct(pos + i, std::move(*first));
+            }
+            return count;
+        }
+
+        // Pops up to n elements into out with a single ticket claim.
+        // Returns the number of elements popped, which is less than n only if the queue ran empty.
+        template <typename OutputIterator>
+        size_t try_pop_n(OutputIterator out, size_t n)
+        {
+            size_t pos;
+            const size_t count = claim(dequeue_pos_, 1, n, pos);
+            for (size_t i = 0; i < count; ++i, ++out)
+            {
+                *out = take(pos + i);
+            }
+            return count;
+        }
+
+      private:
+        using element_storage_type = typename std::aligned_storage<sizeof(Type), std::alignment_of<Type>::value>::type;
+
+        struct cell
+        {
+            std::atomic<size_t> sequence_;
+            element_storage_type data_;
+        };
+
+        static constexpr size_t mask = Capacity - 1;
+
+        // Claims up to n consecutive tickets from counter whose cells are ready (sequence == ticket + offset).
+        // Nobody else can claim a ticket past the counter, so cells seen ready stay ready until we move it.
+        size_t claim(std::atomic<size_t> &counter, size_t offset, size_t n, size_t &pos)
+        {
+            pos = counter.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                size_t count = 0;
+                while (count < n && cells_[(pos + count) & mask].sequence_.load(std::memory_order_acquire) == pos + count + offset)
+                {
+                    ++count;
+                }
+
+                if (!count)
+                {
+                    const size_t seq = cells_[pos & mask].sequence_.load(std::memory_order_acquire);
+                    if (std::ptrdiff_t(seq - (pos + offset)) < 0)
+                    {
+                        // full (producers) or empty (consumers)
+                        return 0;
+                    }
+                    // someone else took the ticket
+                    pos = counter.load(std::memory_order_relaxed);
+                }
+                else if (counter.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed))
+                {
+                    return count;
+                }
+            }
+        }
+
+        void construct(size_t pos, Type val)
+        {
+            cell &c = cells_[pos & mask];
+            new (&c.data_) Type(std::move(val));
+            c.sequence_.store(pos + 1, std::memory_order_release);
+        }
+
+        Type take(size_t pos)
+        {
+            cell &c = cells_[pos & mask];
+            Type *ptr = reinterpret_cast<Type *>(&c.data_);
+            Type result(std::move(*ptr));
+            ptr->~Type();
+            c.sequence_.store(pos + Capacity, std::memory_order_release);
+            return result;
+        }
+
+        cell cells_[Capacity];
+        alignas(64) std::atomic<size_t> enqueue_pos_;
+        alignas(64) std::atomic<size_t> dequeue_pos_;
+    };
+
+} // namespace ulib
+
+#endif
@@ -0,0 +1,264 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MICROLIB_STATIC_RADIX_HEAP_HPP__
+#define MICROLIB_STATIC_RADIX_HEAP_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <microlib/intrusive_pool.hpp>
+#include <type_traits>
+#include <utility>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace ulib
+{
+
+    namespace detail
+    {
+
+        // number of significant bits of x, 0 for x == 0
+        inline size_t radix_bit_width(uint64_t x)
+        {
+            if (!x)
+            {
+                return 0;
+            }
+#if defined(_MSC_VER) && !defined(__clang__)
+            unsigned long index;
+            _BitScanReverse64(&index, x);
+            return size_t(index) + 1;
+#else
+            return size_t(64 - __builtin_clzll(x));
+#endif
+        }
+
+        // index of the lowest set bit, x must not be 0
+        inline size_t radix_lowest_bit(uint64_t x)
+        {
+#if defined(_MSC_VER) && !defined(__clang__)
+            unsigned long index;
+            _BitScanForward64(&index, x);
+            return size_t(index);
+#else
+            return size_t(__builtin_ctzll(x));
+#endif
+        }
+
+        // The key of an unsigned integer is the integer itself.
+        template <typename T>
+        struct radix_identity
+        {
+            T operator()(T val) const
+            {
+                return val;
+            }
+        };
+
+    } // namespace detail
+
+    //
+    // Monotone priority queue for unsigned integer keys with static capacity of Size (radix heap, Ahuja et al.).
+    // Monotone means no key pushed may be smaller than the last one popped, which holds for event
+    // simulation, timers and Dijkstra on non-negative weights.
+    // Elements are kept in buckets by the highest bit in which their key differs from the last
+    // popped key (last_key()). Bucket 0 holds the keys equal to it. When the minimum is asked for and
+    // bucket 0 is empty, the lowest non-empty bucket is split up around its own minimum, every element
+    // moving to a strictly lower bucket. So an element moves at most once per key bit,
+    // and push costs one xor and a bit scan.
+    // KeyOf maps an element to its key; elements with equal keys come out in no particular order.
+    // Buckets are singly linked lists through nodes from a shared intrusive_pool, so T must be
+    // default constructible and move assignable.
+    //
+    template <typename T, unsigned int Size, typename KeyOf = detail::radix_identity<T>>
+    class static_radix_heap : private KeyOf
+    {
+      public:
+        using key_type = typename std::decay<decltype(std::declval<KeyOf>()(std::declval<const T &>()))>::type;
+        using size_type = size_t;
+
+        static_assert(std::is_unsigned<key_type>::value && sizeof(key_type) <= sizeof(uint64_t), "Keys must be unsigned integers.");
+
+      private:
+        static constexpr size_t key_bits = size_t(std::numeric_limits<key_type>::digits);
+        static constexpr size_t buckets = key_bits + 1;
+
+        struct node
+        {
+            T value;
+            node *next;
+
+            friend void intrusive_pool_set_next_free(node *n, node *next)
+            {
+                n->next = next;
+            }
+
+            friend node *intrusive_pool_get_next_free(node *n)
+            {
+                return n->next;
+            }
+        };
+
+      public:
+        static_radix_heap(KeyOf key_of = KeyOf()) : KeyOf(std::move(key_of)), last_(0), size_(0), occupied_(0)
+        {
+            for (auto &head : buckets_)
+            {
+                head = nullptr;
+            }
+        }
+
+        static_radix_heap(const static_radix_heap &) = delete;
+        static_radix_heap &operator=(const static_radix_heap &) = delete;
+
+        // Inserts a value, whose key must not be smaller than last_key().
+        // Returns false iff there is not enough storage capacity left.
+        template <typename ValType>
+        bool push(ValType &&val)
+        {
+            node *n = pool_.acquire();
+            if (!n)
+            {
+                return false;
+            }
+
+            n->value = std::forward<ValType>(val);
+            link(n, bucket_of(key(n->value)));
+            ++size_;
+            return true;
+        }
+
+        template <typename... Args>
+        bool emplace(Args &&... args)
+        {
+            return push(T(std::forward<Args>(args)...));
+        }
+
+        // Returns a reference to an element with the smallest key.
+        // Not const, the buckets get split up on demand. UB if the heap is empty.
+        const T &top_element()
+        {
+            if (!buckets_[0])
+            {
+                refill();
+            }
+            return buckets_[0]->value;
+        }
+
+        // Removes the element top_element() refers to.
+        // UB if the heap is empty.
+        void pop()
+        {
+            if (!buckets_[0])
+            {
+                refill();
+            }
+            node *n = buckets_[0];
+            buckets_[0] = n->next;
+            pool_.release(n);
+            --size_;
+        }
+
+        // Key of the last element popped (or looked at with top_element()), 0 initially.
+        // Pushed keys must not be smaller.
+        key_type last_key() const
+        {
+            return last_;
+        }
+
+        size_type size() const
+        {
+            return size_;
+        }
+
+        bool empty() const
+        {
+            return size_ == 0;
+        }
+
+        constexpr size_type capacity() const
+        {
+            return Size;
+        }
+
+        void clear()
+        {
+            for (auto &head : buckets_)
+            {
+                while (head)
+                {
+                    node *n = head;
+                    head = n->next;
+                    pool_.release(n);
+                }
+            }
+            occupied_ = 0;
+            size_ = 0;
+            last_ = 0;
+        }
+
+      private:
+        key_type key(const T &val) const
+        {
+            return static_cast<const KeyOf &>(*this)(val);
+        }
+
+        size_t bucket_of(key_type k) const
+        {
+            return detail::radix_bit_width(uint64_t(k ^ last_));
+        }
+
+        void link(node *n, size_t bucket)
+        {
+            n->next = buckets_[bucket];
+            buckets_[bucket] = n;
+            if (bucket)
+            {
+                occupied_ |= uint64_t(1) << (bucket - 1);
+            }
+        }
+
+        // Splits the lowest non-empty bucket around its minimum, which becomes the new last_.
+        // All its elements share the bits above the bucket's bit with last_, and the minimum
+        // shares even more with them, so they all land in lower buckets.
+        void refill()
+        {
+            const size_t bucket = detail::radix_lowest_bit(occupied_) + 1;
+            node *list = buckets_[bucket];
+            buckets_[bucket] = nullptr;
+            occupied_ &= occupied_ - 1;
+
+            key_type min_key = key(list->value);
+            for (node *n = list->next; n; n = n->next)
+            {
+                const key_type k = key(n->value);
+                min_key = k < min_key ? k : min_key;
+            }
+
+            last_ = min_key;
+            while (list)
+            {
+                node *n = list;
+                list = n->next;
+                link(n, bucket_of(key(n->value)));
+            }
+        }
+
+        key_type last_;
+        size_type size_;
+
+        // bit b - 1 set iff bucket b is not empty
+        uint64_t occupied_;
+        node *buckets_[buckets];
+        intrusive_pool<node, Size> pool_;
+    };
+
+} // namespace ulib
+
+#endif
@@ -0,0 +1,181 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MICROLIB_STATIC_TOPK_HPP__
+#define MICROLIB_STATIC_TOPK_HPP__
+
+#include "detail/heap_simd.hpp"
+#include <functional>
+#include <iterator>
+#include <microlib/static_heap.hpp>
+#include <type_traits>
+#include <utility>
+
+namespace ulib
+{
+
+    //
+    // Keeps the K largest (with respect to Compare) of all values offered so far, for streams
+    // where most values do not qualify.
+    // The K values sit in a static_heap with the smallest on top. Once K values are held, that
+    // smallest one is the admission threshold; it is cached next to the heap, so a rejected value
+    // costs a single compare. An admitted value replaces the threshold in O(log K).
+    // offer(first, last) on contiguous arithmetic keys ordered by std::less/std::greater scans for
+    // candidates with SIMD compares against the threshold (see detail/heap_simd.hpp).
+    // Of equal values, the ones offered first are kept. T must be default constructible.
+    //
+    template <typename T, size_t K, typename Compare = std::less<T>, size_t Arity = 4>
+    class static_topk
+    {
+        static_assert(K > 0, "K must be at least one.");
+
+      public:
+        using heap_type = static_heap<T, K, Compare, Arity>;
+        using size_type = typename heap_type::size_type;
+        using const_iterator = typename heap_type::const_iterator;
+
+        static_topk(Compare compare = Compare()) : heap_(std::move(compare))
+        {
+        }
+
+        // Returns true iff val was taken in, i.e. it is currently among the K largest.
+        template <typename ValType>
+        bool offer(ValType &&val)
+        {
+            if (heap_.size() == K)
+            {
+                if (!compare(threshold_, val))
+                {
+                    return false;
+                }
+                heap_.replace(std::forward<ValType>(val));
+                threshold_ = heap_.top_element();
+                return true;
+            }
+
+            heap_.push(std::forward<ValType>(val));
+            if (heap_.size() == K)
+            {
+                threshold_ = heap_.top_element();
+            }
+            return true;
+        }
+
+        // Offers all values of [first, last). Returns the number of values taken in.
+        template <typename InputIterator>
+        size_t offer(InputIterator first, InputIterator last)
+        {
+            size_t taken = 0;
+            for (; first != last && heap_.size() != K; ++first, ++taken)
+            {
+                offer(*first);
+            }
+
+            if constexpr (std::is_pointer<InputIterator>::value &&
+                          std::is_same<typename std::remove_cv<typename std::remove_pointer<InputIterator>::type>::type, T>::value)
+            {
+                // candidates are rare, let the scan skip over the rest
+                const T *pos = first;
+                while ((pos = scan::find(pos, last, threshold_, heap_compare())) != last)
+                {
+                    heap_.replace(*pos++);
+                    threshold_ = heap_.top_element();
+                    ++taken;
+                }
+            }
+            else
+            {
+                for (; first != last; ++first)
+                {
+                    if (compare(threshold_, *first))
+                    {
+                        heap_.replace(*first);
+                        threshold_ = heap_.top_element();
+                        ++taken;
+                    }
+                }
+            }
+            return taken;
+        }
+
+        // The smallest value held, which any new value has to exceed once full().
+        // UB if empty.
+        const T &threshold() const
+        {
+            return heap_.top_element();
+        }
+
+        // Writes the values held to [out, out + size()), largest first, and empties the container.
+        // Returns the end of the output range.
+        template <typename RandomAccessIterator>
+        RandomAccessIterator sorted(RandomAccessIterator out)
+        {
+            const size_t count = heap_.size();
+            for (size_t i = count; i > 0; --i)
+            {
+                out[i - 1] = std::move(heap_.top_element());
+                heap_.pop();
+            }
+            return out + count;
+        }
+
+        // The values held, in no particular order.
+        const_iterator begin() const
+        {
+            return heap_.begin();
+        }
+
+        const_iterator end() const
+        {
+            return heap_.end();
+        }
+
+        size_type size() const
+        {
+            return heap_.size();
+        }
+
+        bool empty() const
+        {
+            return heap_.size() == 0;
+        }
+
+        bool full() const
+        {
+            return heap_.size() == K;
+        }
+
+        constexpr size_t capacity() const
+        {
+            return K;
+        }
+
+        void clear()
+        {
+            heap_.clear();
+        }
+
+      private:
+        using scan = detail::heap_threshold_scan<T, Compare>;
+
+        Compare &heap_compare()
+        {
+            return *static_cast<Compare *>(&heap_);
+        }
+
+        bool compare(const T &a, const T &b)
+        {
+            return heap_compare()(a, b);
+        }
+
+        heap_type heap_;
+
+        // copy of the heap top, valid while full
+        T threshold_;
+    };
+
+} // namespace ulib
+
+#endif
@@ -7,6 +7,8 @@
 #define MICROLIB_STATIC_VECTOR_HPP__
 
 #include <algorithm>
+#include <cstring>
+#include <limits>
 #include <microlib/util.hpp>
 #include <type_traits>
 
@@ -41,14 +43,14 @@ namespace ulib
             using element_storage_type = typename std::aligned_storage<SizeOfT, AlignOfT>::type;
             using size_type = auto_size_type_t<Size>;
 
-            size_type &size_ref()
+            size_type get_size() const
             {
                 return size_;
             }
 
-            const size_type &size_ref() const
+            void set_size(size_type size)
             {
-                return size_;
+                size_ = size;
             }
 
             void *data()
@@ -66,8 +68,9 @@ namespace ulib
                 return Size - Base;
             }
 
-            size_type size_;
+            // elements first, so aligning the vector aligns the elements
             element_storage_type data_[Size];
+            size_type size_;
         };
 
         template <size_t SizeOfT, size_t AlignOfT, size_t Size, size_t Base>
@@ -76,14 +79,19 @@ namespace ulib
             using element_storage_type = typename std::aligned_storage<SizeOfT, AlignOfT>::type;
             using size_type = auto_size_type_t<Size>;
 
-            size_type &size_ref()
+            // The size lives in the bytes of the unused elements, which never hold a size_type object,
+            // so it is copied in and out: going through a size_type pointer would break the aliasing rules,
+            // which optimizers do exploit. The copies compile to plain loads and stores.
+            size_type get_size() const
             {
-                return *reinterpret_cast<size_type *>(data());
+                size_type size;
+                std::memcpy(&size, data(), sizeof(size));
+                return size;
             }
 
-            const size_type &size_ref() const
+            void set_size(size_type size)
             {
-                return *reinterpret_cast<const size_type *>(data());
+                std::memcpy(data(), &size, sizeof(size));
             }
 
             void *data()
@@ -119,7 +127,7 @@ namespace ulib
 
         static_vector()
         {
-            storage::size_ref() = 0;
+            storage::set_size(0);
         }
 
         bool push_back(T &&val)
@@ -127,7 +135,7 @@ namespace ulib
             if (size() != capacity())
             {
                 new (data() + Base + size()) T(std::move(val));
-                ++storage::size_ref();
+                storage::set_size(size_type(size() + 1));
                 return true;
             }
             else
@@ -141,7 +149,7 @@ namespace ulib
             if (size() != capacity())
             {
                 new (data() + Base + size()) T(val);
-                ++storage::size_ref();
+                storage::set_size(size_type(size() + 1));
                 return true;
             }
             else
@@ -156,7 +164,7 @@ namespace ulib
             if (size() != capacity())
             {
                 new (data() + Base + size()) T(std::forward<Args>(args)...);
-                ++storage::size_ref();
+                storage::set_size(size_type(size() + 1));
                 return true;
             }
             else
@@ -174,13 +182,13 @@ namespace ulib
         void pop_front()
         {
             std::rotate(begin(), begin() + 1, end());
-            --storage::size_ref();
+            storage::set_size(size_type(size() - 1));
             (data() + size() + Base)->~T();
         }
 
         void pop_back()
         {
-            --storage::size_ref();
+            storage::set_size(size_type(size() - 1));
             (data() + size() + Base)->~T();
         }
 
@@ -246,7 +254,7 @@ namespace ulib
 
         size_type size() const
         {
-            return storage::size_ref();
+            return storage::get_size();
         }
 
         size_type capacity() const
@@ -260,7 +268,7 @@ namespace ulib
             {
                 elem.~T();
             }
-            storage::size_ref() = 0;
+            storage::set_size(0);
         }
     };
 
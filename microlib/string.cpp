@@ -18,17 +18,23 @@ namespace ulib
 
     int string::printf(const char *fmt, ...)
     {
-        int ret;
         va_list myargs;
         va_start(myargs, fmt);
+        int ret = vprintf(fmt, myargs);
+        va_end(myargs);
+        return ret;
+    }
+
+    // Appends; the output is dropped if it does not fit.
+    int string::vprintf(const char *fmt, va_list args)
+    {
         size_t avail = available();
 
-        ret = vsnprintf(data_, avail, fmt, myargs);
+        int ret = vsnprintf(data_ + size_, avail + 1, fmt, args);
         if (ret >= 0 && size_t(ret) <= avail)
         {
             size_ += ret;
         }
-        va_end(myargs);
         return ret;
     }
 
@@ -6,6 +6,7 @@
 #ifndef MICROLIB_STRING_HPP__
 #define MICROLIB_STRING_HPP__
 
+#include <cstdarg>
 #include <cstring>
 
 namespace ulib
@@ -17,6 +18,7 @@ namespace ulib
         string(char *data, size_t max_size);
 
         int printf(const char *fmt, ...);
+        int vprintf(const char *fmt, va_list args);
         const char *data() const;
         const char *c_string() const;
 
@@ -27,7 +29,7 @@ namespace ulib
 
         string &operator+=(const string &other);
 
-      private:
+      protected:
         char *data_;
         size_t max_size_;
         size_t size_;
@@ -0,0 +1,272 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MICROLIB_TIMER_WHEEL_HPP__
+#define MICROLIB_TIMER_WHEEL_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <microlib/intrusive_pool.hpp>
+#include <utility>
+
+namespace ulib
+{
+
+    namespace detail
+    {
+
+        // Link of the circular doubly linked bucket lists. Every bucket has a sentinel,
+        // so unlinking needs neither the bucket nor a branch on the list ends.
+        struct wheel_link
+        {
+            wheel_link *prev_;
+            wheel_link *next_;
+
+            void init()
+            {
+                prev_ = next_ = this;
+            }
+
+            bool empty() const
+            {
+                return next_ == this;
+            }
+
+            void push_back(wheel_link *link)
+            {
+                link->prev_ = prev_;
+                link->next_ = this;
+                prev_->next_ = link;
+                prev_ = link;
+            }
+
+            void unlink()
+            {
+                prev_->next_ = next_;
+                next_->prev_ = prev_;
+            }
+        };
+
+    } // namespace detail
+
+    //
+    // Hierarchical timing wheel with room for Capacity timers (G. Varghese, A. Lauck).
+    // Time is counted in the caller's units; one tick is Granularity units.
+    // Level l has 2^SlotBits buckets, each spanning 2^(SlotBits * l) ticks, so the wheel covers
+    // 2^(SlotBits * Levels) ticks ahead; timers beyond that wait in the last bucket and are re-filed
+    // when it comes up. Timers due within the same tick fire in the order they were armed,
+    // a timer is never fired early but may fire up to one tick late.
+    // arm() and cancel() are O(1), advance() costs O(1) per elapsed tick plus O(1) per timer
+    // moved down a level or fired. Timer entries come from an intrusive_pool, so Payload must be
+    // default constructible and move assignable.
+    //
+    template <typename Payload, unsigned int Capacity, uint64_t Granularity = 1, size_t Levels = 4, size_t SlotBits = 6>
+    class timer_wheel
+    {
+        static_assert(Granularity > 0, "Granularity must be at least one time unit.");
+        static_assert(Levels > 0 && SlotBits > 0 && SlotBits * Levels < 64, "Wheel must cover between 1 and 2^63 ticks.");
+
+        static constexpr size_t slots = size_t(1) << SlotBits;
+        static constexpr uint64_t slot_mask = slots - 1;
+
+      public:
+        struct timer : private detail::wheel_link
+        {
+            Payload payload;
+
+          private:
+            friend class timer_wheel;
+            uint64_t expiry_;
+
+            friend void intrusive_pool_set_next_free(timer *t, timer *next)
+            {
+                t->next_ = next;
+            }
+
+            friend timer *intrusive_pool_get_next_free(timer *t)
+            {
+                return static_cast<timer *>(t->next_);
+            }
+        };
+
+        // Starts at time now.
+        explicit timer_wheel(uint64_t now = 0) : now_(now / Granularity), size_(0)
+        {
+            for (auto &level : buckets_)
+            {
+                for (auto &bucket : level)
+                {
+                    bucket.init();
+                }
+            }
+        }
+
+        timer_wheel(const timer_wheel &) = delete;
+        timer_wheel &operator=(const timer_wheel &) = delete;
+
+        // Arms a timer firing at time expiry or, if that has passed already, at the next tick.
+        // The returned handle is valid until the timer fired or was cancelled.
+        // Returns nullptr iff all Capacity timers are in use.
+        template <typename... Args>
+        timer *arm(uint64_t expiry, Args &&... args)
+        {
+            timer *t = pool_.acquire();
+            if (t)
+            {
+                t->payload = Payload(std::forward<Args>(args)...);
+                // round up, timers never fire early
+                t->expiry_ = (expiry + Granularity - 1) / Granularity;
+                // the bucket of the current tick has fired already
+                file(t, now_ + 1);
+                ++size_;
+            }
+            return t;
+        }
+
+        // Disarms a pending timer.
+        void cancel(timer *t)
+        {
+            t->unlink();
+            pool_.release(t);
+            --size_;
+        }
+
+        // Moves the time forward to now and fires every timer due until then, calling fire(payload)
+        // for each. fire may arm and cancel other timers, but not the one it was called for.
+        // Returns the number of timers fired.
+        template <typename Fire>
+        size_t advance(uint64_t now, Fire &&fire)
+        {
+            const uint64_t target = now / Granularity;
+            size_t fired = 0;
+
+            while (now_ < target)
+            {
+                if (!size_)
+                {
+                    now_ = target;
+                    break;
+                }
+
+                ++now_;
+                cascade();
+                fired += expire(buckets_[0][now_ & slot_mask], fire);
+            }
+            return fired;
+        }
+
+        // Current time, rounded down to the tick.
+        uint64_t now() const
+        {
+            return now_ * Granularity;
+        }
+
+        size_t size() const
+        {
+            return size_;
+        }
+
+        bool empty() const
+        {
+            return size_ == 0;
+        }
+
+        constexpr size_t capacity() const
+        {
+            return Capacity;
+        }
+
+      private:
+        static constexpr uint64_t level_shift(size_t level)
+        {
+            return SlotBits * level;
+        }
+
+        // puts t into the bucket its expiry (but at least earliest) falls into, as seen from the current tick
+        void file(timer *t, uint64_t earliest)
+        {
+            const uint64_t expiry = t->expiry_ > earliest ? t->expiry_ : earliest;
+            const uint64_t delta = expiry - now_;
+
+            size_t level = 0;
+            while (level + 1 < Levels && delta >> level_shift(level + 1))
+            {
+                ++level;
+            }
+
+            uint64_t slot_tick = expiry;
+            if (delta >> level_shift(Levels))
+            {
+                // out of range, park it in the farthest bucket
+                slot_tick = now_ + (uint64_t(slot_mask) << level_shift(Levels - 1));
+            }
+            buckets_[level][(slot_tick >> level_shift(level)) & slot_mask].push_back(t);
+        }
+
+        // When the lower levels wrap around, the current bucket of the next level gets re-filed.
+        // Higher levels go first, so their timers can land in the lower buckets re-filed next.
+        void cascade()
+        {
+            size_t level = 0;
+            while (level + 1 < Levels && ((now_ >> level_shift(level)) & slot_mask) == 0)
+            {
+                ++level;
+            }
+
+            for (; level > 0; --level)
+            {
+                detail::wheel_link &bucket = buckets_[level][(now_ >> level_shift(level)) & slot_mask];
+                while (!bucket.empty())
+                {
+                    timer *t = static_cast<timer *>(bucket.next_);
+                    t->unlink();
+                    file(t, now_);
+                }
+            }
+        }
+
+        // fires all timers of a level 0 bucket, releasing them to the pool as one chain
+        template <typename Fire>
+        size_t expire(detail::wheel_link &bucket, Fire &fire)
+        {
+            timer *first = nullptr;
+            timer *last = nullptr;
+            size_t fired = 0;
+
+            while (!bucket.empty())
+            {
+                timer *t = static_cast<timer *>(bucket.next_);
+                t->unlink();
+                --size_;
+                ++fired;
+                fire(t->payload);
+
+                if (last)
+                {
+                    intrusive_pool_set_next_free(last, t);
+                }
+                else
+                {
+                    first = t;
+                }
+                last = t;
+            }
+
+            if (first)
+            {
+                pool_.release_chain(first, last);
+            }
+            return fired;
+        }
+
+        uint64_t now_;
+        size_t size_;
+        detail::wheel_link buckets_[Levels][slots];
+        intrusive_pool<timer, Capacity> pool_;
+    };
+
+} // namespace ulib
+
+#endif
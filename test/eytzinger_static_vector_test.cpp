@@ -0,0 +1,228 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "eytzinger_static_vector_test.hpp"
+#include "stdafx.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <microlib/eytzinger_static_vector.hpp>
+#include <microlib/sorted_static_vector.hpp>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+    unsigned int a = 1140671485;
+    unsigned int c = 12820163;
+    unsigned int seed = 123541236;
+
+    unsigned int myrand()
+    {
+        return seed = ((seed * a + c) & 0xFFFFFF);
+    }
+
+    // key plus its position in sorted order, which tells equal keys apart
+    struct entry
+    {
+        int key;
+        int rank;
+    };
+
+    struct entry_compare
+    {
+        bool operator()(const entry &a, const entry &b) const
+        {
+            return a.key < b.key;
+        }
+
+        bool operator()(const entry &a, int key) const
+        {
+            return a.key < key;
+        }
+
+        bool operator()(int key, const entry &b) const
+        {
+            return key < b.key;
+        }
+    };
+
+    // lookups and both conversions against the sorted layout, for every size up to Size
+    template <size_t Size>
+    void reference_test()
+    {
+        using sorted_type = ulib::sorted_static_vector<entry, Size, entry_compare>;
+        using eytzinger_type = ulib::eytzinger_static_vector<entry, Size, entry_compare>;
+
+        std::vector<int> keys;
+        for (size_t size = 0; size <= Size; ++size)
+        {
+            std::vector<entry> sorted;
+            for (size_t i = 0; i < keys.size(); ++i)
+            {
+                sorted.push_back(entry{keys[i], int(i)});
+            }
+
+            eytzinger_type eytzinger;
+            const size_t assigned = eytzinger.assign_sorted(sorted.begin(), sorted.end());
+            assert(assigned == size);
+            (void)assigned;
+            assert(eytzinger.size() == size);
+
+            for (int key = -1; key <= 41; ++key)
+            {
+                [[maybe_unused]] const auto lower = std::lower_bound(sorted.begin(), sorted.end(), key, entry_compare());
+                [[maybe_unused]] const auto upper = std::upper_bound(sorted.begin(), sorted.end(), key, entry_compare());
+
+                [[maybe_unused]] const auto e_lower = eytzinger.lower_bound(key);
+                [[maybe_unused]] const auto e_upper = eytzinger.upper_bound(key);
+                assert(lower == sorted.end() ? e_lower == eytzinger.end() : e_lower->rank == lower->rank);
+                assert(upper == sorted.end() ? e_upper == eytzinger.end() : e_upper->rank == upper->rank);
+                assert(eytzinger.contains(key) == (lower != upper));
+                assert(eytzinger.find(key) == (lower != upper ? e_lower : eytzinger.end()));
+            }
+
+            std::vector<entry> out(size);
+            assert(eytzinger.copy_sorted(out.begin()) == out.end());
+            for (size_t i = 0; i < size; ++i)
+            {
+                assert(out[i].rank == int(i));
+            }
+
+            const sorted_type back = eytzinger.to_sorted();
+            assert(back.size() == size);
+            for (size_t i = 0; i < size; ++i)
+            {
+                assert(back[i].rank == int(i));
+            }
+
+            const eytzinger_type again(back);
+            assert(std::equal(again.begin(), again.end(), eytzinger.begin(),
+                              [](const entry &x, const entry &y) { return x.rank == y.rank; }));
+
+            keys.push_back(int((myrand() >> 8) % 40));
+            std::sort(keys.begin(), keys.end());
+        }
+    }
+
+    struct order
+    {
+        int price;
+        int quantity;
+    };
+
+    struct order_compare
+    {
+        bool operator()(const order &a, const order &b) const
+        {
+            return a.price < b.price;
+        }
+    };
+
+    // an element ordered by key, int or order
+    template <typename T>
+    T keyed(int key)
+    {
+        if constexpr (std::is_same<T, order>::value)
+        {
+            return order{key, 0};
+        }
+        else
+        {
+            return T(key);
+        }
+    }
+
+    template <typename Container, typename Lookup>
+    void lookup_benchmark(const char *name, const Container &container, const std::vector<int> &keys, Lookup lookup)
+    {
+        constexpr unsigned int lookups = 1 << 22;
+
+        // independent lookups, which may overlap
+        size_t sum = 0;
+        auto begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int i = 0; i < lookups; ++i)
+        {
+            sum += size_t(lookup(container, keys[i & 4095]));
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        const double throughput = double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / lookups;
+
+        // the previous result feeds into the next key, so lookups cannot overlap
+        begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int i = 0; i < lookups; ++i)
+        {
+            sum += size_t(lookup(container, keys[((i + unsigned(sum)) * 2654435761u) >> 20]));
+        }
+        end = std::chrono::high_resolution_clock::now();
+        const double latency = double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / lookups;
+
+        std::cout << name << ": " << throughput << "ns/lookup independent, " << latency << "ns/lookup dependent (" << sum << ")\n";
+    }
+
+    template <typename T, typename Compare, size_t Size>
+    void lookup_benchmarks(const char *type)
+    {
+        using sorted_type = ulib::sorted_static_vector<T, Size, Compare>;
+        using eytzinger_type = ulib::eytzinger_static_vector<T, Size, Compare>;
+
+        // large sizes would not fit onto the stack
+        auto sorted = std::make_unique<sorted_type>();
+        for (size_t i = 0; i < Size; ++i)
+        {
+            sorted->emplace_binary(keyed<T>(int(2 * i)));
+        }
+        auto eytzinger = std::make_unique<eytzinger_type>(*sorted);
+
+        std::vector<int> keys(4096);
+        for (auto &key : keys)
+        {
+            key = int(((myrand() << 8) ^ myrand()) % (2 * Size));
+        }
+
+        // all report the key found, so the sums must agree
+        std::cout << type << " " << Size << ":\n";
+        lookup_benchmark("  std::lower_bound", *sorted, keys, [](const sorted_type &vec, int key) {
+            const auto it = std::lower_bound(vec.begin(), vec.end(), keyed<T>(key), Compare());
+            return it != vec.end() ? *reinterpret_cast<const int *>(&*it) : -1;
+        });
+        lookup_benchmark("  sorted          ", *sorted, keys, [](const sorted_type &vec, int key) {
+            const auto it = vec.lower_bound(keyed<T>(key));
+            return it != vec.end() ? *reinterpret_cast<const int *>(&*it) : -1;
+        });
+        lookup_benchmark("  eytzinger       ", *eytzinger, keys, [](const eytzinger_type &vec, int key) {
+            const auto it = vec.lower_bound(keyed<T>(key));
+            return it != vec.end() ? *reinterpret_cast<const int *>(&*it) : -1;
+        });
+    }
+
+    template <size_t Size>
+    void lookup_benchmarks()
+    {
+        lookup_benchmarks<int, std::less<int>, Size>("int");
+        lookup_benchmarks<order, order_compare, Size>("order");
+    }
+
+} // namespace
+
+void eytzinger_static_vector_test()
+{
+    std::cout << "Eytzinger vector test:\n\n";
+
+    reference_test<1>();
+    reference_test<2>();
+    reference_test<70>();
+
+    lookup_benchmarks<8>();
+    lookup_benchmarks<64>();
+    lookup_benchmarks<512>();
+    lookup_benchmarks<4096>();
+    lookup_benchmarks<32768>();
+    lookup_benchmarks<262144>();
+
+    std::cout << "\n";
+}
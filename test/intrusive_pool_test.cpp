@@ -0,0 +1,151 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "intrusive_pool_test.hpp"
+#include "stdafx.h"
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <microlib/intrusive_pool.hpp>
+#include <mutex>
+
+namespace
+{
+    struct buffer
+    {
+        buffer *next_;
+        char data_[120];
+    };
+
+    void intrusive_pool_set_next_free(buffer *buff, buffer *next)
+    {
+        buff->next_ = next;
+    }
+
+    buffer *intrusive_pool_get_next_free(buffer *buff)
+    {
+        return buff->next_;
+    }
+
+    struct std_mutex
+    {
+        void protect()
+        {
+            mutex_.lock();
+            ++locks_;
+        }
+
+        void unprotect()
+        {
+            mutex_.unlock();
+        }
+
+        std::mutex mutex_;
+        unsigned long long locks_ = 0;
+    };
+
+    using pool_type = ulib::intrusive_pool<buffer, 256, std_mutex>;
+
+    constexpr unsigned int burst = 64;
+    constexpr unsigned int rounds = 200000;
+
+    void batch_test()
+    {
+        static pool_type pool;
+        buffer *burst_buffers[burst];
+
+        [[maybe_unused]] unsigned int acquired = pool.acquire_n(burst_buffers, burst);
+        assert(acquired == burst);
+        pool.release_n(burst_buffers, burst);
+
+        for (unsigned int i = 0; i < 4; ++i)
+        {
+            acquired = pool.acquire_n(burst_buffers, burst);
+            assert(acquired == burst);
+        }
+        acquired = pool.acquire_n(burst_buffers, burst);
+        assert(acquired == 0);
+        [[maybe_unused]] buffer *const extra = pool.acquire();
+        assert(extra == nullptr);
+
+        // hand a pre-linked chain back
+        for (buffer &buff : pool)
+        {
+            buff.next_ = &buff + 1;
+        }
+        pool.release_chain(pool.begin(), pool.end() - 1);
+        acquired = pool.acquire_n(burst_buffers, burst);
+        assert(acquired == burst);
+        assert(burst_buffers[0] == pool.begin() && burst_buffers[burst - 1] == pool.begin() + burst - 1);
+    }
+
+    void statistics_test()
+    {
+        static ulib::intrusive_pool<buffer, 8, ulib::NoConcurrency, ulib::pool_statistics> pool;
+        buffer *buffers[8];
+
+        [[maybe_unused]] unsigned int acquired = pool.acquire_n(buffers, 6);
+        assert(acquired == 6);
+        pool.release_n(buffers, 2);
+        acquired = pool.acquire_n(buffers, 6);
+        assert(acquired == 4);
+        [[maybe_unused]] buffer *const extra = pool.acquire();
+        assert(extra == nullptr);
+
+        [[maybe_unused]] auto stats = pool.statistics();
+        assert(stats.in_use == 8 && stats.high_water == 8 && stats.failures == 2 && stats.allocations == 10);
+
+        buffers[0]->next_ = buffers[1];
+        pool.release_chain(buffers[0], buffers[1]);
+        stats = pool.statistics();
+        assert(stats.in_use == 6 && stats.high_water == 8);
+    }
+
+    template <typename Body>
+    void measure(const char *name, Body body)
+    {
+        static pool_type pool;
+        buffer *burst_buffers[burst];
+
+        pool.locks_ = 0;
+        auto begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int i = 0; i < rounds; ++i)
+        {
+            body(pool, burst_buffers);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        std::cout << name << " ns/element: "
+                  << double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / (double(rounds) * burst)
+                  << " locks/burst: " << double(pool.locks_) / rounds << "\n";
+    }
+
+} // namespace
+
+void intrusive_pool_test()
+{
+    std::cout << "Intrusive pool test:\n\n";
+
+    batch_test();
+    statistics_test();
+
+    measure("Per element:", [](pool_type &pool, buffer **buffers) {
+        for (unsigned int j = 0; j < burst; ++j)
+        {
+            buffers[j] = pool.acquire();
+        }
+        for (unsigned int j = 0; j < burst; ++j)
+        {
+            pool.release(buffers[j]);
+        }
+    });
+
+    measure("Batched:    ", [](pool_type &pool, buffer **buffers) {
+        pool.acquire_n(buffers, burst);
+        pool.release_n(buffers, burst);
+    });
+
+    std::cout << "\n";
+}
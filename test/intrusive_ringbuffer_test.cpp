@@ -0,0 +1,146 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "intrusive_ringbuffer_test.hpp"
+#include "stdafx.h"
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <microlib/intrusive_ringbuffer.hpp>
+#include <thread>
+
+namespace
+{
+    struct packet
+    {
+        unsigned int sequence_;
+        char data_[60];
+    };
+
+    using spsc_ring = ulib::intrusive_ringbuffer<packet, 256, ulib::SingleProducerSingleConsumer>;
+
+    template <typename Ring>
+    packet *wait_idle(Ring &ring)
+    {
+        packet *result;
+        while (!(result = ring.idle_front()))
+        {
+            std::this_thread::yield();
+        }
+        return result;
+    }
+
+    template <typename Ring>
+    packet *wait_committed(Ring &ring)
+    {
+        packet *result;
+        while (!(result = ring.committed_front()))
+        {
+            std::this_thread::yield();
+        }
+        return result;
+    }
+
+    void single_thread_test()
+    {
+        static ulib::intrusive_ringbuffer<packet, 4, ulib::SingleProducerSingleConsumer> ring;
+
+        assert(ring.empty() && !ring.full());
+        for (unsigned int i = 0; i < 4; ++i)
+        {
+            ring.idle_front()->sequence_ = i;
+            ring.commit();
+        }
+        assert(ring.full() && ring.idle_front() == nullptr);
+
+        for (unsigned int round = 0; round < 10; ++round)
+        {
+            assert(ring.committed_front()->sequence_ == round);
+            ring.release();
+            ring.idle_front()->sequence_ = round + 4;
+            ring.commit();
+            assert(ring.full());
+        }
+    }
+
+    void throughput_benchmark()
+    {
+        static spsc_ring ring;
+        const unsigned int count = 10000000;
+        unsigned int errors = 0;
+
+        auto begin = std::chrono::high_resolution_clock::now();
+
+        std::thread consumer([&errors, count]() {
+            for (unsigned int i = 0; i < count; ++i)
+            {
+                if (wait_committed(ring)->sequence_ != i)
+                {
+                    ++errors;
+                }
+                ring.release();
+            }
+        });
+
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            wait_idle(ring)->sequence_ = i;
+            ring.commit();
+        }
+        consumer.join();
+
+        auto end = std::chrono::high_resolution_clock::now();
+        assert(errors == 0);
+
+        std::cout << "Throughput packets/us: " << double(count) / std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()
+                  << "\n";
+    }
+
+    void ping_pong_benchmark()
+    {
+        static spsc_ring ping;
+        static spsc_ring pong;
+        const unsigned int count = 100000;
+
+        auto begin = std::chrono::high_resolution_clock::now();
+
+        std::thread echo([count]() {
+            for (unsigned int i = 0; i < count; ++i)
+            {
+                const unsigned int sequence = wait_committed(ping)->sequence_;
+                ping.release();
+                wait_idle(pong)->sequence_ = sequence;
+                pong.commit();
+            }
+        });
+
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            wait_idle(ping)->sequence_ = i;
+            ping.commit();
+            [[maybe_unused]] const unsigned int echoed = wait_committed(pong)->sequence_;
+            assert(echoed == i);
+            pong.release();
+        }
+        echo.join();
+
+        auto end = std::chrono::high_resolution_clock::now();
+
+        std::cout << "Round trip ns:         " << double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / count
+                  << "\n";
+    }
+
+} // namespace
+
+void intrusive_ringbuffer_test()
+{
+    std::cout << "Intrusive ringbuffer test:\n\n";
+
+    single_thread_test();
+    throughput_benchmark();
+    ping_pong_benchmark();
+
+    std::cout << "\n";
+}
@@ -15,27 +15,47 @@ auto sum( Iterator begin, Iterator end )
 
     return value;
 }
-
-template<typename T, typename S = std::enable_if_t<std::is_unsigned<T>::value>>
-struct overflow_compare
-{
-    constexpr overflow_compare() {}
-
-    constexpr bool operator()(T a, T b) const {
-        return T(b - a) <= (std::numeric_limits<T>::max() / 2);
-    }
-};
 */
 
+#include "eytzinger_static_vector_test.hpp"
+#include "intrusive_pool_test.hpp"
+#include "intrusive_ringbuffer_test.hpp"
+#include "monotonic_arena_test.hpp"
+#include "pool_test.hpp"
+#include "priority_queue_test.hpp"
+#include "serial_compare_test.hpp"
+#include "size_class_allocator_test.hpp"
 #include "sorted_static_vector_test.hpp"
+#include "static_addressable_heap_test.hpp"
+#include "static_flat_map_test.hpp"
 #include "static_heap_test.hpp"
 #include "static_interval_heap_test.hpp"
+#include "static_minmax_heap_test.hpp"
+#include "static_mpmc_queue_test.hpp"
+#include "static_radix_heap_test.hpp"
+#include "static_topk_test.hpp"
 #include "static_vector_test.hpp"
+#include "timer_wheel_test.hpp"
 
 int main()
 {
     static_vector_test();
     static_heap_test();
+    static_addressable_heap_test();
     static_interval_heap_test();
+    static_minmax_heap_test();
+    static_topk_test();
+    static_radix_heap_test();
+    timer_wheel_test();
+    priority_queue_test();
+    serial_compare_test();
     sorted_static_vector_test();
+    eytzinger_static_vector_test();
+    static_flat_map_test();
+    pool_test();
+    intrusive_ringbuffer_test();
+    intrusive_pool_test();
+    size_class_allocator_test();
+    monotonic_arena_test();
+    static_mpmc_queue_test();
 }
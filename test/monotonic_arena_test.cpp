@@ -0,0 +1,201 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "monotonic_arena_test.hpp"
+#include "stdafx.h"
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <microlib/monotonic_arena.hpp>
+#include <string>
+#include <vector>
+
+namespace
+{
+    unsigned int a = 1140671485;
+    unsigned int c = 12820163;
+    unsigned int seed = 123541236;
+
+    unsigned int myrand()
+    {
+        return seed = ((seed * a + c) & 0xFFFFFF);
+    }
+
+    alignas(64) unsigned char buffer[1 << 16];
+
+    void arena_test()
+    {
+        ulib::monotonic_arena arena(buffer);
+
+        [[maybe_unused]] auto *c1 = arena.allocate(1, 1);
+        [[maybe_unused]] auto *d = arena.allocate(sizeof(double), alignof(double));
+        assert(c1 && d && reinterpret_cast<uintptr_t>(d) % alignof(double) == 0);
+        [[maybe_unused]] auto *too_large = arena.allocate(sizeof(buffer));
+        assert(too_large == nullptr);
+
+        [[maybe_unused]] const auto mark = arena.mark();
+        {
+            ulib::arena_scope scope(arena);
+            [[maybe_unused]] auto *ints = arena.allocate_array<int>(100);
+            assert(ints);
+            assert(arena.used() > mark);
+        }
+        assert(arena.mark() == mark);
+
+        [[maybe_unused]] auto *block = arena.allocate(16, 16);
+        [[maybe_unused]] const bool extended = arena.extend(block, 64);
+        assert(extended);
+        assert(!arena.extend(d, 64));
+        [[maybe_unused]] auto *after = arena.allocate(1, 1);
+        assert(after == static_cast<unsigned char *>(block) + 64);
+
+        arena.reset();
+        assert(arena.used() == 0 && arena.available() == sizeof(buffer));
+    }
+
+    void pmr_test()
+    {
+        ulib::monotonic_arena arena(buffer, 1024);
+        ulib::arena_resource resource(arena, std::pmr::new_delete_resource());
+
+        std::pmr::vector<int> vec(&resource);
+        for (int i = 0; i < 1000; ++i)
+        {
+            vec.push_back(i);
+        }
+        // outgrew the arena and moved upstream
+        assert(!arena.owns(vec.data()) && vec[999] == 999);
+    }
+
+    void string_test()
+    {
+        ulib::monotonic_arena arena(buffer);
+
+        ulib::arena_string str(arena, 8);
+        [[maybe_unused]] char *first = const_cast<char *>(str.data());
+        str.printf("%d-%d", 1234, 5678);
+        str.printf("/%s", "grown in place");
+        assert(str.data() == first);
+        assert(std::strcmp(str.c_string(), "1234-5678/grown in place") == 0);
+
+        // another allocation in between forces the next growth to move
+        arena.allocate(1);
+        const size_t capacity = str.capacity();
+        while (str.capacity() == capacity)
+        {
+            str.printf("x");
+        }
+        assert(str.data() != first);
+        assert(std::strncmp(str.c_string(), "1234-5678/grown in place", 24) == 0);
+
+        ulib::static_string<16> other;
+        other.printf("%s", "tail");
+        str += other;
+        assert(str.size() == capacity + 4);
+    }
+
+    //
+    // Typical request lifecycle: parse some header fields into strings, collect some ids, build a status line.
+
+    constexpr unsigned int requests = 100000;
+
+    const char *const header_value = "application/x-www-form-urlencoded";
+
+    unsigned int arena_request(ulib::monotonic_arena &arena, ulib::arena_resource &resource, unsigned int r)
+    {
+        ulib::arena_scope scope(arena);
+
+        std::pmr::vector<ulib::arena_string *> headers(&resource);
+        for (unsigned int i = 0; i < 8 + r % 8; ++i)
+        {
+            auto *value = new (arena.allocate(sizeof(ulib::arena_string))) ulib::arena_string(arena, 64);
+            *value += ulib::const_string(header_value + i);
+            headers.push_back(value);
+        }
+
+        auto *ids = arena.allocate_array<unsigned int>(64);
+        for (unsigned int i = 0; i < 64; ++i)
+        {
+            ids[i] = r ^ i;
+        }
+
+        ulib::arena_string response(arena);
+        response.printf("HTTP/1.1 200 OK %u", ids[r % 64]);
+
+        unsigned int result = unsigned(response.size());
+        for (auto *h : headers)
+        {
+            result += unsigned(h->size());
+        }
+        return result;
+    }
+
+    unsigned int heap_request(unsigned int r)
+    {
+        std::vector<std::unique_ptr<std::string>> headers;
+        for (unsigned int i = 0; i < 8 + r % 8; ++i)
+        {
+            headers.push_back(std::make_unique<std::string>(header_value + i));
+        }
+
+        std::unique_ptr<unsigned int[]> ids(new unsigned int[64]);
+        for (unsigned int i = 0; i < 64; ++i)
+        {
+            ids[i] = r ^ i;
+        }
+
+        char line[32];
+        std::snprintf(line, sizeof(line), "HTTP/1.1 200 OK %u", ids[r % 64]);
+        std::string response(line);
+
+        unsigned int result = unsigned(response.size());
+        for (auto &h : headers)
+        {
+            result += unsigned(h->size());
+        }
+        return result;
+    }
+
+    template <typename Request>
+    double measure(Request request, unsigned int &checksum)
+    {
+        auto begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int i = 0; i < requests; ++i)
+        {
+            checksum += request(myrand());
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        return double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / requests;
+    }
+
+} // namespace
+
+void monotonic_arena_test()
+{
+    std::cout << "Monotonic arena test:\n\n";
+
+    arena_test();
+    pmr_test();
+    string_test();
+
+    ulib::monotonic_arena arena(buffer);
+    ulib::arena_resource resource(arena);
+
+    unsigned int arena_checksum = 0;
+    unsigned int heap_checksum = 0;
+    const unsigned int start = seed;
+    const double arena_time = measure([&](unsigned int r) { return arena_request(arena, resource, r); }, arena_checksum);
+    seed = start;
+    const double heap_time = measure(heap_request, heap_checksum);
+    assert(arena_checksum == heap_checksum && arena.used() == 0);
+
+    std::cout << "arena ns/request:      " << arena_time << "\n";
+    std::cout << "new/delete ns/request: " << heap_time << "\n";
+
+    std::cout << "\n";
+}
@@ -0,0 +1,444 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "pool_test.hpp"
+#include "stdafx.h"
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <microlib/compact_pool.hpp>
+#include <microlib/growable_pool.hpp>
+#include <microlib/magazine_pool.hpp>
+#include <microlib/pool.hpp>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct std_mutex
+    {
+        void protect()
+        {
+            mutex_.lock();
+        }
+
+        void unprotect()
+        {
+            mutex_.unlock();
+        }
+
+        std::mutex mutex_;
+    };
+
+    struct payload
+    {
+        payload(unsigned int owner, unsigned int serial) : owner_(owner), serial_(serial)
+        {
+        }
+
+        unsigned int owner_;
+        unsigned int serial_;
+    };
+
+    constexpr unsigned int pool_size = 1024;
+    constexpr unsigned int held_per_thread = 16;
+
+    // the generation count in the lock-free head must not wrap while a thread sits preempted in pop()
+    using lock_free_list = ulib::detail::pool_freelist<ulib::detail::pool_element_type<payload>, pool_size, ulib::LockFree>;
+    static_assert(!std::atomic<uint64_t>::is_always_lock_free || sizeof(lock_free_list::head_type) * 8 - lock_free_list::index_bits >= 32,
+                  "Lock-free pools need a wide generation count.");
+
+    // Every thread keeps a few elements alive and verifies nobody else scribbled over them.
+    template <typename Pool>
+    void stress_thread(Pool &pool, unsigned int id, unsigned int iterations, std::atomic<unsigned int> &errors)
+    {
+        std::vector<ulib::pool_ptr<payload>> held(held_per_thread);
+        for (unsigned int i = 0; i < iterations; ++i)
+        {
+            auto &slot = held[i % held_per_thread];
+            if (slot && (slot->owner_ != id || slot->serial_ != i - held_per_thread))
+            {
+                ++errors;
+            }
+            slot = pool.make(id, i);
+        }
+    }
+
+    template <typename Pool>
+    double run_threads(Pool &pool, unsigned int threads, unsigned int iterations, std::atomic<unsigned int> &errors)
+    {
+        std::vector<std::thread> workers;
+
+        auto begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&pool, &errors, t, iterations]() { stress_thread(pool, t, iterations, errors); });
+        }
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        return double(threads) * iterations / std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+    }
+
+    template <typename Pool>
+    unsigned int drain(Pool &pool)
+    {
+        std::vector<ulib::pool_ptr<payload>> all;
+        while (auto ptr = pool.make(0, 0))
+        {
+            all.push_back(std::move(ptr));
+        }
+        return static_cast<unsigned int>(all.size());
+    }
+
+    template <typename Pool>
+    void stress_test()
+    {
+        static Pool pool;
+        std::atomic<unsigned int> errors(0);
+
+        run_threads(pool, 8, 200000, errors);
+
+        [[maybe_unused]] const unsigned int drained = drain(pool);
+        assert(errors == 0);
+        assert(drained == pool_size);
+    }
+
+    // Each instance of a magazine_pool type gets a magazine of its own on a thread, up to magazines_per_thread.
+    // A magazine shows as elements held back from other threads until flush().
+    void magazine_test()
+    {
+        using pool_type = ulib::magazine_pool<payload, 64, 8>;
+        constexpr size_t instances = pool_type::magazines_per_thread + 1;
+
+        // the first make() fetches half a magazine, the release puts its element back there
+        [[maybe_unused]] constexpr unsigned int cached = 4;
+
+        for (unsigned int round = 0; round < 2; ++round)
+        {
+            // destroyed at the end of each round, so the second round binds the magazines afresh
+            auto pools = std::make_unique<pool_type[]>(instances);
+            for (size_t i = 0; i < instances; ++i)
+            {
+                pools[i].make(0, 0);
+            }
+
+            unsigned int available[instances];
+            std::thread([&]() {
+                for (size_t i = 0; i < instances; ++i)
+                {
+                    available[i] = drain(pools[i]);
+                }
+            }).join();
+            for (size_t i = 0; i < instances; ++i)
+            {
+                // the last instance found no free magazine and went to the shared freelist
+                assert(available[i] == (i + 1 < instances ? 64 - cached : 64));
+            }
+
+            for (size_t i = 0; i < instances; ++i)
+            {
+                pools[i].flush();
+            }
+            std::thread([&]() {
+                for (size_t i = 0; i < instances; ++i)
+                {
+                    available[i] = drain(pools[i]);
+                }
+            }).join();
+            for (size_t i = 0; i < instances; ++i)
+            {
+                assert(available[i] == 64);
+            }
+        }
+    }
+
+    template <typename Pool>
+    void benchmark(const char *name)
+    {
+        std::cout << name << ":\n";
+        for (unsigned int threads = 1; threads <= 8; threads *= 2)
+        {
+            static Pool pool;
+            std::atomic<unsigned int> errors(0);
+            const double ops = run_threads(pool, threads, 1000000 / threads, errors);
+            assert(errors == 0);
+            std::cout << "  threads: " << threads << " ops/us: " << ops << "\n";
+        }
+    }
+
+    // new_delete_upstream counting the slabs handed back
+    struct counting_upstream : ulib::new_delete_upstream
+    {
+        counting_upstream() : deallocations(0)
+        {
+        }
+
+        void deallocate(void *ptr, size_t bytes, size_t align)
+        {
+            ++deallocations;
+            ulib::new_delete_upstream::deallocate(ptr, bytes, align);
+        }
+
+        size_t deallocations;
+    };
+
+    // empty slabs go back upstream, except for the last one with free elements
+    template <size_t SlabSize>
+    void growable_return_test()
+    {
+        ulib::growable_pool<payload, SlabSize, counting_upstream, true> pool;
+        std::vector<ulib::pool_ptr<payload>> held;
+        for (unsigned int i = 0; i < 10 * SlabSize; ++i)
+        {
+            held.push_back(pool.make(0, i));
+        }
+        assert(pool.stats().slabs == 10);
+
+        held.clear();
+        assert(pool.stats().slabs == 1);
+        assert(pool.upstream().deallocations == 9);
+    }
+
+    void growable_test()
+    {
+        growable_return_test<1>();
+        growable_return_test<2>();
+        growable_return_test<64>();
+
+        {
+            ulib::growable_pool<payload, 64, ulib::new_delete_upstream, true> pool;
+            std::vector<ulib::pool_ptr<payload>> held;
+            for (unsigned int i = 0; i < 1000; ++i)
+            {
+                held.push_back(pool.make(0, i));
+            }
+
+            auto stats = pool.stats();
+            assert(stats.in_use == 1000 && stats.slabs == 16);
+
+            held.clear();
+            stats = pool.stats();
+            assert(stats.in_use == 0 && stats.in_use_high_water == 1000 && stats.slabs == 1 && stats.slabs_high_water == 16);
+        }
+
+        {
+            ulib::growable_pool<payload, 64, ulib::static_block_arena<ulib::growable_pool_slab_size<payload, 64>, 4>> pool;
+            std::vector<ulib::pool_ptr<payload>> held;
+            while (auto ptr = pool.make(0, 0))
+            {
+                held.push_back(std::move(ptr));
+            }
+            assert(held.size() == 256);
+        }
+    }
+
+    unsigned int seed = 123541236;
+
+    unsigned int myrand()
+    {
+        return seed = ((seed * 1140671485 + 12820163) & 0xFFFFFF);
+    }
+
+    // Bursts of random size up to pool_size, allocated and then freed.
+    template <typename Pool>
+    void growable_benchmark(const char *name, Pool &pool)
+    {
+        std::vector<ulib::pool_ptr<payload>> held;
+        held.reserve(pool_size);
+        unsigned int ops = 0;
+        seed = 123541236;
+
+        auto begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int i = 0; i < 10000; ++i)
+        {
+            const unsigned int burst = myrand() % pool_size;
+            for (unsigned int j = 0; j < burst; ++j)
+            {
+                held.push_back(pool.make(0, j));
+            }
+            held.clear();
+            ops += 2 * burst;
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        std::cout << name << " ns/op: " << double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / ops << "\n";
+    }
+
+    template <typename Pool>
+    void growable_benchmark(const char *name)
+    {
+        static Pool pool;
+        growable_benchmark(name, pool);
+
+        const auto stats = pool.stats();
+        std::cout << "  high water: " << stats.in_use_high_water << " elements, " << stats.slabs_high_water << " slabs, "
+                  << stats.bytes_high_water << " bytes (static pool: " << sizeof(ulib::pool<payload, pool_size>) << " bytes)\n";
+    }
+
+    struct message8
+    {
+        message8(unsigned int a, unsigned int b) : a_(a), b_(b)
+        {
+        }
+
+        unsigned int a_;
+        unsigned int b_;
+    };
+
+    struct message16
+    {
+        message16(unsigned int a, unsigned int b) : a_(a), b_(b), c_(0)
+        {
+        }
+
+        unsigned int a_;
+        unsigned int b_;
+        unsigned long long c_;
+    };
+
+    template <typename Pool, typename Payload>
+    void iteration_benchmark(const char *name)
+    {
+        constexpr unsigned int count = 1 << 18;
+        static Pool pool;
+        std::vector<typename Pool::pointer_type> held;
+        std::vector<Payload *> payloads;
+
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            held.push_back(pool.make(i, i));
+            payloads.push_back(held.back().get());
+        }
+
+        unsigned long long sum = 0;
+        auto begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int round = 0; round < 100; ++round)
+        {
+            for (auto *payload : payloads)
+            {
+                sum += payload->a_;
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        assert(sum == 100ull * count * (count - 1) / 2);
+
+        std::cout << name << " bytes/element: " << sizeof(typename Pool::element_type)
+                  << " elements/cache line: " << 64.0 / sizeof(typename Pool::element_type)
+                  << " ns/element: " << double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / (100.0 * count)
+                  << " (" << (sum & 1) << ")\n";
+    }
+
+    // Locked pools count exactly. Lock-free pools count per thread, the sums are exact once the threads are done.
+    void statistics_test()
+    {
+        {
+            static ulib::pool<payload, 4, ulib::NoConcurrency, ulib::pool_statistics> pool;
+            auto a = pool.make(0, 0);
+            auto b = pool.make(0, 1);
+            a.clear();
+            [[maybe_unused]] const auto stats = pool.statistics();
+            assert(stats.in_use == 1 && stats.high_water == 2 && stats.allocations == 2 && stats.failures == 0);
+        }
+
+        {
+            static ulib::pool<payload, 4, ulib::LockFree, ulib::pool_statistics> pool;
+            ulib::pool_ptr<payload> held[4];
+            for (auto &ptr : held)
+            {
+                ptr = pool.make(0, 0);
+            }
+            [[maybe_unused]] const bool exhausted = !pool.make(0, 0);
+            held[0].clear();
+            [[maybe_unused]] const auto stats = pool.statistics();
+            assert(exhausted && stats.in_use == 3 && stats.high_water == 4 && stats.allocations == 4 && stats.failures == 1);
+        }
+
+        {
+            constexpr unsigned int threads = 8;
+            constexpr unsigned int iterations = 20000;
+            static ulib::pool<payload, pool_size, ulib::LockFree, ulib::pool_statistics> pool;
+            std::atomic<unsigned int> errors(0);
+            run_threads(pool, threads, iterations, errors);
+            [[maybe_unused]] const auto stats = pool.statistics();
+            assert(errors == 0 && stats.in_use == 0 && stats.allocations == threads * iterations && stats.failures == 0);
+            assert(stats.high_water > 0 && stats.high_water <= threads * (held_per_thread + 1));
+        }
+    }
+
+    template <typename Pool>
+    void statistics_benchmark(const char *name)
+    {
+        static Pool pool;
+        std::vector<ulib::pool_ptr<payload>> held(held_per_thread);
+
+        auto begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int i = 0; i < 10000000; ++i)
+        {
+            held[i % held_per_thread] = pool.make(0, i);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        std::cout << name << " ns/op: " << double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / 10000000
+                  << "\n";
+    }
+
+} // namespace
+
+void pool_test()
+{
+    std::cout << "Pool test:\n\n";
+
+    stress_test<ulib::pool<payload, pool_size, ulib::LockFree>>();
+    stress_test<ulib::magazine_pool<payload, pool_size>>();
+    magazine_test();
+
+    benchmark<ulib::pool<payload, pool_size, std_mutex>>("Mutex pool");
+    benchmark<ulib::pool<payload, pool_size, ulib::LockFree>>("Lock-free pool");
+    benchmark<ulib::magazine_pool<payload, pool_size>>("Magazine pool");
+
+    growable_test();
+
+    {
+        static ulib::pool<payload, pool_size> pool;
+        growable_benchmark("Static pool:              ", pool);
+    }
+    growable_benchmark<ulib::growable_pool<payload, 64>>("Growable pool:            ");
+    growable_benchmark<ulib::growable_pool<payload, 64, ulib::new_delete_upstream, true>>("Growable pool, returning: ");
+
+    iteration_benchmark<ulib::pool<message8, 1 << 18>, message8>("pool<8 byte>:          ");
+    iteration_benchmark<ulib::compact_pool<message8, 1 << 18>, message8>("compact_pool<8 byte>:  ");
+    iteration_benchmark<ulib::pool<message16, 1 << 18>, message16>("pool<16 byte>:         ");
+    iteration_benchmark<ulib::compact_pool<message16, 1 << 18>, message16>("compact_pool<16 byte>: ");
+
+    statistics_test();
+    statistics_benchmark<ulib::pool<payload, pool_size>>("Statistics off:            ");
+    statistics_benchmark<ulib::pool<payload, pool_size, ulib::NoConcurrency, ulib::pool_statistics>>("Statistics on:             ");
+    statistics_benchmark<ulib::pool<payload, pool_size, std_mutex>>("Mutex, statistics off:     ");
+    statistics_benchmark<ulib::pool<payload, pool_size, std_mutex, ulib::pool_statistics>>("Mutex, statistics on:      ");
+    statistics_benchmark<ulib::pool<payload, pool_size, ulib::LockFree>>("Lock-free, statistics off: ");
+    statistics_benchmark<ulib::pool<payload, pool_size, ulib::LockFree, ulib::pool_statistics>>("Lock-free, statistics on:  ");
+
+    {
+        static ulib::compact_pool<message8, 4> pool;
+        auto ptr = pool.make(1, 2);
+        auto moved = std::move(ptr);
+        assert(!ptr && moved && moved->b_ == 2);
+
+        auto *raw = moved.release_type();
+        assert(pool.contains(raw));
+        auto back = ulib::compact_pool_ptr<ulib::compact_pool<message8, 4>>::from_type_ptr(pool, raw);
+        assert(back.get() == raw);
+    }
+
+    std::cout << "\n";
+}
@@ -0,0 +1,290 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "priority_queue_test.hpp"
+#include "stdafx.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <microlib/priority_queue.hpp>
+#include <microlib/sorted_static_vector.hpp>
+#include <microlib/static_addressable_heap.hpp>
+#include <microlib/static_heap.hpp>
+#include <microlib/static_interval_heap.hpp>
+#include <microlib/static_minmax_heap.hpp>
+#include <vector>
+
+namespace
+{
+    unsigned int a = 1140671485;
+    unsigned int c = 12820163;
+    unsigned int seed = 123541236;
+
+    unsigned int myrand()
+    {
+        return seed = ((seed * a + c) & 0xFFFFFF);
+    }
+
+    void priority_queue_order_test()
+    {
+        static ulib::static_priority_queue<int, 100> queue;
+        std::vector<int> values;
+
+        for (int i = 0; i < 100; ++i)
+        {
+            values.push_back(int(myrand() % 1000));
+            [[maybe_unused]] const bool inserted = queue.insert(values.back());
+            assert(inserted);
+        }
+        [[maybe_unused]] const bool overflowed = queue.insert(0);
+        assert(!overflowed);
+
+        // erase some from the middle
+        for (int i = 0; i < 10; ++i)
+        {
+            auto it = queue.begin() + myrand() % queue.size();
+            values.erase(std::find(values.begin(), values.end(), *it));
+            queue.erase(it);
+        }
+
+        std::sort(values.begin(), values.end(), std::greater<int>());
+        for ([[maybe_unused]] int val : values)
+        {
+            assert(queue.top() == val);
+            queue.pop();
+        }
+        assert(queue.empty());
+    }
+
+    // Sequence numbers crossing the wrap-around of a 16 bit counter still come out newest first.
+    void wrap_around_test()
+    {
+        static ulib::static_priority_queue_wrap_around<uint16_t, 64> queue;
+
+        for (unsigned int i = 0; i < 64; ++i)
+        {
+            queue.insert(uint16_t(0xFFE0 + (i * 37) % 64));
+        }
+
+        uint16_t expected = uint16_t(0xFFE0 + 63);
+        while (!queue.empty())
+        {
+            assert(queue.top() == expected);
+            queue.pop();
+            --expected;
+        }
+    }
+
+    //
+    // Shared benchmark: every priority queue structure of the library on the same workloads,
+    // taking keys out in priority order (least first, except for the wrap-around queue, which is newest first).
+    // Keys are 24 bit, so the serial number order agrees with the plain one.
+
+    constexpr unsigned int queue_size = 4096;
+    using key = uint32_t;
+
+    // keeps the popped keys alive
+    volatile key sink;
+
+    template <size_t Arity>
+    struct heap_adaptor
+    {
+        ulib::static_heap<key, queue_size, std::less<key>, Arity> queue;
+
+        void push(key k)
+        {
+            queue.push(k);
+        }
+
+        key pop()
+        {
+            const key top = queue.top_element();
+            queue.pop();
+            return top;
+        }
+    };
+
+    struct addressable_heap_adaptor
+    {
+        ulib::static_addressable_heap<key, queue_size, std::less<key>, 4> queue;
+
+        void push(key k)
+        {
+            queue.push(k);
+        }
+
+        key pop()
+        {
+            const key top = queue.top_element();
+            queue.pop();
+            return top;
+        }
+    };
+
+    struct interval_heap_adaptor
+    {
+        ulib::static_inverval_heap<key, queue_size> queue;
+
+        void push(key k)
+        {
+            queue.push(k);
+        }
+
+        key pop()
+        {
+            const key top = queue.min_element();
+            queue.pop_min();
+            return top;
+        }
+    };
+
+    struct minmax_heap_adaptor
+    {
+        ulib::static_minmax_heap<key, queue_size> queue;
+
+        void push(key k)
+        {
+            queue.push(k);
+        }
+
+        key pop()
+        {
+            const key top = queue.min_element();
+            queue.pop_min();
+            return top;
+        }
+    };
+
+    template <typename Queue>
+    struct priority_queue_adaptor
+    {
+        Queue queue;
+
+        void push(key k)
+        {
+            queue.insert(k);
+        }
+
+        key pop()
+        {
+            const key top = queue.top();
+            queue.pop();
+            return top;
+        }
+    };
+
+    // sorted descending, so the least element is popped from the back
+    struct sorted_vector_adaptor
+    {
+        ulib::sorted_static_vector<key, queue_size, std::greater<key>> queue;
+
+        void push(key k)
+        {
+            queue.emplace_binary(k);
+        }
+
+        key pop()
+        {
+            const key top = queue.max_element();
+            queue.pop_back();
+            return top;
+        }
+    };
+
+    double ns_per_op(std::chrono::high_resolution_clock::time_point begin, unsigned int ops)
+    {
+        auto end = std::chrono::high_resolution_clock::now();
+        return double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / ops;
+    }
+
+    // fill: push queue_size keys, then pop them all
+    // hold: at constant size, pop one and push a new one
+    // mixed: push or pop at random, between empty and full
+    template <typename Adaptor>
+    void run_suite(const char *name)
+    {
+        constexpr unsigned int rounds = 20;
+        constexpr unsigned int ops = queue_size * 8;
+        static Adaptor adaptor;
+        key checksum = 0;
+
+        seed = 4711;
+        auto begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int round = 0; round < rounds; ++round)
+        {
+            for (unsigned int i = 0; i < queue_size; ++i)
+            {
+                adaptor.push(myrand());
+            }
+            for (unsigned int i = 0; i < queue_size; ++i)
+            {
+                checksum += adaptor.pop();
+            }
+        }
+        const double fill = ns_per_op(begin, rounds * queue_size * 2);
+
+        for (unsigned int i = 0; i < queue_size; ++i)
+        {
+            adaptor.push(myrand());
+        }
+        begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int i = 0; i < ops; ++i)
+        {
+            checksum += adaptor.pop();
+            adaptor.push(myrand());
+        }
+        const double hold = ns_per_op(begin, ops * 2);
+
+        unsigned int size = queue_size;
+        begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int i = 0; i < ops; ++i)
+        {
+            if (size == queue_size || (size && (myrand() & 0x100)))
+            {
+                checksum += adaptor.pop();
+                --size;
+            }
+            else
+            {
+                adaptor.push(myrand());
+                ++size;
+            }
+        }
+        const double mixed = ns_per_op(begin, ops);
+
+        while (size--)
+        {
+            checksum += adaptor.pop();
+        }
+
+        sink = checksum;
+        std::cout << name << " fill: " << fill << "  hold: " << hold << "  mixed: " << mixed << "\n";
+    }
+
+} // namespace
+
+void priority_queue_test()
+{
+    std::cout << "Priority queue test:\n\n";
+
+    priority_queue_order_test();
+    wrap_around_test();
+
+    std::cout << "Priority queue benchmark, " << queue_size << " uint32 keys, ns per operation:\n";
+    run_suite<heap_adaptor<2>>("static_heap                       ");
+    run_suite<heap_adaptor<4>>("static_heap 4-ary                 ");
+    run_suite<heap_adaptor<8>>("static_heap 8-ary                 ");
+    run_suite<addressable_heap_adaptor>("static_addressable_heap 4-ary     ");
+    run_suite<interval_heap_adaptor>("static_inverval_heap              ");
+    run_suite<minmax_heap_adaptor>("static_minmax_heap                ");
+    run_suite<priority_queue_adaptor<ulib::static_priority_queue<key, queue_size, std::greater<key>>>>(
+        "static_priority_queue             ");
+    run_suite<priority_queue_adaptor<ulib::static_priority_queue_wrap_around<key, queue_size>>>("static_priority_queue_wrap_around ");
+    run_suite<sorted_vector_adaptor>("sorted_static_vector              ");
+    std::cout << "\n";
+}
@@ -0,0 +1,270 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "serial_compare_test.hpp"
+#include "stdafx.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <microlib/serial_compare.hpp>
+#include <microlib/sorted_static_vector.hpp>
+#include <microlib/static_heap.hpp>
+#include <microlib/static_interval_heap.hpp>
+#include <vector>
+
+namespace
+{
+    unsigned int a = 1140671485;
+    unsigned int c = 12820163;
+    unsigned int seed = 123541236;
+
+    unsigned int myrand()
+    {
+        return seed = ((seed * a + c) & 0xFFFFFF);
+    }
+
+    template <typename T, size_t Bits>
+    void comparator_test()
+    {
+        using space = ulib::detail::serial_space<T, Bits>;
+        // only used in asserts
+        [[maybe_unused]] ulib::serial_less<T, Bits> less;
+        [[maybe_unused]] ulib::serial_greater<T, Bits> greater;
+        [[maybe_unused]] const T top = space::mask;
+
+        assert(less(T(top - 2), T(1)));
+        assert(!less(T(1), T(top - 2)));
+        assert(greater(T(1), top));
+        assert(!less(T(5), T(5)) && !greater(T(5), T(5)));
+
+        // exactly half the space apart is unordered, one less is ordered
+        assert(!less(T(0), space::half) && !less(space::half, T(0)));
+        assert(less(T(0), T(space::half - 1)));
+        assert(less(T(space::half + 1), T(0)));
+
+        assert(ulib::serial_add<Bits>(top, T(3)) == T(2));
+        assert(ulib::serial_difference<Bits>(top, T(2)) == 3);
+        assert(ulib::serial_difference<Bits>(T(2), top) == -3);
+    }
+
+    // Feeds blocks of consecutive serial numbers across the wrap-around in shuffled order and
+    // expects them back in sequence. The heap never spans more than window numbers.
+    template <typename T, size_t Bits, size_t Arity, size_t Window>
+    void heap_wrap_test()
+    {
+        using space = ulib::detail::serial_space<T, Bits>;
+        static_assert(Window < space::half, "Window must be smaller than half the number space.");
+
+        static ulib::static_heap<T, Window, ulib::serial_less<T, Bits>, Arity> heap;
+        const size_t block = Window / 2;
+        T next_push = T(space::mask - 3 * Window);
+        T next_pop = next_push;
+
+        std::vector<T> values;
+        for (unsigned int round = 0; round < 16; ++round)
+        {
+            values.clear();
+            for (size_t i = 0; i < block; ++i)
+            {
+                values.push_back(next_push);
+                next_push = ulib::serial_add<Bits>(next_push, T(1));
+            }
+            for (size_t i = values.size(); i > 1; --i)
+            {
+                std::swap(values[i - 1], values[(myrand() >> 8) % i]);
+            }
+            for (T val : values)
+            {
+                const bool pushed = heap.push(val);
+                assert(pushed);
+                (void)pushed;
+            }
+            assert(heap.test_invariant());
+
+            if (round == 0)
+            {
+                continue;
+            }
+            for (size_t i = 0; i < block; ++i)
+            {
+                assert(heap.top_element() == next_pop);
+                heap.pop();
+                next_pop = ulib::serial_add<Bits>(next_pop, T(1));
+            }
+        }
+        heap.clear();
+    }
+
+    template <typename T, size_t Bits>
+    void interval_heap_wrap_test()
+    {
+        using space = ulib::detail::serial_space<T, Bits>;
+        static ulib::static_inverval_heap<T, 64, ulib::serial_less<T, Bits>> heap;
+
+        const T first = T(space::mask - 20);
+        for (unsigned int i = 0; i < 64; ++i)
+        {
+            heap.push(ulib::serial_add<Bits>(first, T((i * 37) % 64)));
+        }
+        assert(heap.test_invariant());
+
+        T min = first;
+        T max = ulib::serial_add<Bits>(first, T(63));
+        while (heap.size())
+        {
+            assert(heap.min_element() == min);
+            assert(heap.max_element() == max);
+            heap.pop_min();
+            min = ulib::serial_add<Bits>(min, T(1));
+            if (heap.size())
+            {
+                heap.pop_max();
+                max = ulib::serial_add<Bits>(max, T(-1));
+            }
+        }
+    }
+
+    void sorted_vector_wrap_test()
+    {
+        ulib::sorted_static_vector<uint16_t, 128, ulib::serial_less<uint16_t, 12>> vec;
+
+        for (unsigned int i = 0; i < 128; ++i)
+        {
+            vec.emplace_binary(ulib::serial_add<12>(uint16_t(0xFC0), uint16_t((i * 53) % 128)));
+        }
+
+        assert(vec.min_element() == 0xFC0);
+        assert(vec.max_element() == 0x03F);
+        for (size_t i = 1; i < vec.size(); ++i)
+        {
+            assert(vec[i] == ulib::serial_add<12>(vec[i - 1], uint16_t(1)));
+        }
+    }
+
+    // the vectorized child selection has to pick the same child as a scalar scan
+    template <typename T, size_t Arity, typename Compare>
+    void simd_select_test()
+    {
+        using select = ulib::detail::heap_child_select<T, Arity, Compare>;
+        if constexpr (select::enabled)
+        {
+            using space = typename Compare::space;
+            Compare compare;
+            T group[Arity];
+
+            for (unsigned int round = 0; round < 100000; ++round)
+            {
+                // small spread around a random base, so duplicates and wrapping groups are common
+                const T base = T(myrand() >> 4);
+                const T spread = T(round % 2 ? 7 : space::half / 2);
+                for (auto &val : group)
+                {
+                    val = ulib::serial_add<Compare::bits>(base, T(T(myrand() >> 8) % spread));
+                }
+
+                size_t best = 0;
+                for (size_t i = 1; i < Arity; ++i)
+                {
+                    best = compare(group[i], group[best]) ? i : best;
+                }
+                assert(select::select(group) == best);
+            }
+        }
+    }
+
+    double ns_per_op(std::chrono::high_resolution_clock::time_point begin, unsigned int ops)
+    {
+        auto end = std::chrono::high_resolution_clock::now();
+        return double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / ops;
+    }
+
+    // Sliding window of in-flight sequence numbers: every step retires the oldest and
+    // admits one up to Spread ahead of the newest, wrapping around many times.
+    template <typename T, size_t Arity, typename Compare>
+    double window_benchmark(const char *name)
+    {
+        constexpr size_t size = 4096;
+        constexpr unsigned int steps = 4000000;
+        constexpr unsigned int spread = 4096;
+
+        static ulib::static_heap<T, size, Compare, Arity> heap;
+        heap.clear();
+
+        T next = 0;
+        for (size_t i = 0; i < size; ++i)
+        {
+            heap.push(T(next + (myrand() >> 8) % spread));
+            next = T(next + 1);
+        }
+
+        unsigned long long sum = 0;
+        auto begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int i = 0; i < steps; ++i)
+        {
+            sum += heap.top_element();
+            heap.pop();
+            heap.push(T(next + (myrand() >> 8) % spread));
+            next = T(next + 1);
+        }
+        const double ns = ns_per_op(begin, steps);
+
+        std::cout << "  " << name << ": " << ns << "ns per pop+push (" << (sum & 1) << ")\n";
+        return ns;
+    }
+
+    void serial_compare_benchmark()
+    {
+        std::cout << "Sequence window, 4096 in flight:\n";
+        // std::less breaks at every wrap-around, it is only there for the cost of the comparison
+        window_benchmark<uint32_t, 2, std::less<uint32_t>>("uint32, std::less, 2-ary        ");
+        window_benchmark<uint32_t, 2, ulib::serial_less<uint32_t>>("uint32, serial_less, 2-ary     ");
+        window_benchmark<uint32_t, 4, ulib::serial_less<uint32_t>>("uint32, serial_less, 4-ary     ");
+        window_benchmark<uint32_t, 8, ulib::serial_less<uint32_t>>("uint32, serial_less, 8-ary     ");
+        window_benchmark<uint16_t, 2, ulib::serial_less<uint16_t>>("uint16, serial_less, 2-ary     ");
+        window_benchmark<uint16_t, 8, ulib::serial_less<uint16_t>>("uint16, serial_less, 8-ary     ");
+        window_benchmark<uint32_t, 8, ulib::serial_less<uint32_t, 24>>("24 bit, serial_less, 8-ary     ");
+        std::cout << "\n";
+    }
+
+} // namespace
+
+void serial_compare_test()
+{
+    std::cout << "Serial number compare test:\n\n";
+
+    comparator_test<uint8_t, 8>();
+    comparator_test<uint16_t, 12>();
+    comparator_test<uint16_t, 16>();
+    comparator_test<uint32_t, 24>();
+    comparator_test<uint32_t, 32>();
+    comparator_test<uint64_t, 48>();
+    comparator_test<uint64_t, 64>();
+
+    heap_wrap_test<uint8_t, 8, 2, 32>();
+    heap_wrap_test<uint16_t, 12, 8, 512>();
+    heap_wrap_test<uint16_t, 16, 8, 4096>();
+    heap_wrap_test<uint32_t, 24, 4, 1024>();
+    heap_wrap_test<uint32_t, 32, 8, 4096>();
+    heap_wrap_test<uint64_t, 64, 4, 1024>();
+
+    interval_heap_wrap_test<uint8_t, 8>();
+    interval_heap_wrap_test<uint16_t, 12>();
+    interval_heap_wrap_test<uint32_t, 32>();
+
+    sorted_vector_wrap_test();
+
+    simd_select_test<uint16_t, 8, ulib::serial_less<uint16_t>>();
+    simd_select_test<uint16_t, 8, ulib::serial_greater<uint16_t>>();
+    simd_select_test<uint16_t, 8, ulib::serial_less<uint16_t, 12>>();
+    simd_select_test<uint32_t, 4, ulib::serial_less<uint32_t>>();
+    simd_select_test<uint32_t, 4, ulib::serial_greater<uint32_t, 20>>();
+    simd_select_test<uint32_t, 8, ulib::serial_less<uint32_t>>();
+    simd_select_test<uint32_t, 8, ulib::serial_greater<uint32_t, 24>>();
+
+    serial_compare_benchmark();
+}
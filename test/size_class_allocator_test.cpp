@@ -0,0 +1,153 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "size_class_allocator_test.hpp"
+#include "stdafx.h"
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <microlib/size_class_allocator.hpp>
+#include <vector>
+
+namespace
+{
+    unsigned int a = 1140671485;
+    unsigned int c = 12820163;
+    unsigned int seed = 123541236;
+
+    unsigned int myrand()
+    {
+        return seed = ((seed * a + c) & 0xFFFFFF);
+    }
+
+    static_assert(std::is_same_v<ulib::size_classes::power_of_2<16, 128>, ulib::size_classes::list<16, 32, 64, 128>>);
+    static_assert(std::is_same_v<ulib::size_classes::quarter_steps<16, 128>, ulib::size_classes::list<16, 32, 48, 64, 80, 112, 128>>);
+
+    using allocator_type = ulib::size_class_allocator<ulib::size_classes::quarter_steps<16, 2048>, 512>;
+
+    // Mostly small control messages, some medium payloads, rarely large ones.
+    size_t message_size()
+    {
+        const unsigned int r = myrand() % 100;
+        if (r < 60)
+        {
+            return 8 + myrand() % 56;
+        }
+        else if (r < 95)
+        {
+            return 64 + myrand() % 448;
+        }
+        else
+        {
+            return 512 + myrand() % 1536;
+        }
+    }
+
+    void functional_test()
+    {
+        static ulib::size_class_allocator<ulib::size_classes::power_of_2<16, 64>, 2> allocator;
+
+        void *small1 = allocator.allocate(10);
+        [[maybe_unused]] void *small2 = allocator.allocate(16);
+        [[maybe_unused]] void *spill = allocator.allocate(8); // 16 byte class is exhausted, served from 32
+        assert(small1 && small2 && spill && allocator.owns(spill));
+        [[maybe_unused]] void *too_large = allocator.allocate(65);
+        assert(too_large == nullptr);
+
+        allocator.deallocate(small1);
+        [[maybe_unused]] void *reused = allocator.allocate(16);
+        assert(reused == small1);
+
+        [[maybe_unused]] int outside;
+        assert(!allocator.owns(&outside));
+    }
+
+    void pmr_test()
+    {
+        static allocator_type allocator;
+        ulib::size_class_resource<allocator_type> resource(allocator, std::pmr::new_delete_resource());
+
+        std::pmr::vector<int> vec(&resource);
+        for (int i = 0; i < 1000; ++i)
+        {
+            vec.push_back(i);
+        }
+        assert(allocator.owns(vec.data()) == (vec.capacity() * sizeof(int) <= allocator_type::largest_block));
+        assert(vec[999] == 999);
+    }
+
+    struct workload
+    {
+        static constexpr unsigned int live = 256;
+        static constexpr unsigned int steps = 1 << 16;
+
+        workload()
+        {
+            for (unsigned int i = 0; i < steps; ++i)
+            {
+                slots[i] = myrand() % live;
+                sizes[i] = message_size();
+            }
+        }
+
+        unsigned short slots[steps];
+        unsigned short sizes[steps];
+    };
+
+    // Keeps a window of live messages, replacing a random one each step.
+    // The first round warms up caches and page tables and is not measured.
+    template <typename Alloc, typename Free>
+    double run(const workload &load, Alloc alloc, Free free)
+    {
+        constexpr unsigned int rounds = 30;
+        void *messages[workload::live] = {};
+        auto begin = std::chrono::high_resolution_clock::now();
+
+        for (unsigned int round = 0; round <= rounds; ++round)
+        {
+            if (round == 1)
+            {
+                begin = std::chrono::high_resolution_clock::now();
+            }
+
+            for (unsigned int i = 0; i < workload::steps; ++i)
+            {
+                void *&slot = messages[load.slots[i]];
+                free(slot);
+                slot = alloc(load.sizes[i]);
+                static_cast<char *>(slot)[0] = char(i);
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        for (void *msg : messages)
+        {
+            free(msg);
+        }
+
+        return double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / (double(rounds) * workload::steps);
+    }
+
+} // namespace
+
+void size_class_allocator_test()
+{
+    static allocator_type allocator;
+
+    std::cout << "Size class allocator test:\n\n";
+
+    functional_test();
+    pmr_test();
+
+    static workload load;
+    std::cout << "size_class_allocator ns/op: "
+              << run(load, [](size_t bytes) { return allocator.allocate(bytes); }, [](void *ptr) { allocator.deallocate(ptr); }) << "\n";
+    std::cout << "malloc/free ns/op:          "
+              << run(load, [](size_t bytes) { return std::malloc(bytes); }, [](void *ptr) { std::free(ptr); }) << "\n";
+
+    std::cout << "\n";
+}
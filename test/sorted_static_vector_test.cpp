@@ -5,9 +5,14 @@
 
 #include "sorted_static_vector_test.hpp"
 #include "stdafx.h"
+#include <algorithm>
+#include <cassert>
 #include <chrono>
 #include <iostream>
 #include <microlib/sorted_static_vector.hpp>
+#include <string>
+#include <type_traits>
+#include <vector>
 
 
 namespace
@@ -20,6 +25,420 @@ namespace
     {
         return seed = ((seed * a + c) & 0xFFFFFF);
     }
+
+    void replace_test()
+    {
+        ulib::sorted_static_vector<int, 64> vec;
+        std::vector<int> reference;
+
+        for (unsigned int i = 0; i < 64; ++i)
+        {
+            reference.push_back(int((myrand() >> 8) % 100));
+            vec.emplace_binary(reference.back());
+        }
+
+        for (unsigned int i = 0; i < 10000; ++i)
+        {
+            const int val = int((myrand() >> 8) % 100);
+            std::sort(reference.begin(), reference.end());
+            if (myrand() & 0x100)
+            {
+                vec.replace_min(val);
+                reference.front() = val;
+            }
+            else
+            {
+                vec.replace_max(val);
+                reference.back() = val;
+            }
+            std::sort(reference.begin(), reference.end());
+            assert(std::equal(vec.begin(), vec.end(), reference.begin()));
+        }
+    }
+
+    struct order
+    {
+        int price;
+        int quantity;
+    };
+
+    // orders by price, also against bare prices
+    struct order_compare
+    {
+        bool operator()(const order &a, const order &b) const
+        {
+            return a.price < b.price;
+        }
+
+        bool operator()(const order &a, int price) const
+        {
+            return a.price < price;
+        }
+
+        bool operator()(int price, const order &b) const
+        {
+            return price < b.price;
+        }
+    };
+
+    // an element ordered by key, int or order
+    template <typename T>
+    T keyed(int key)
+    {
+        if constexpr (std::is_same<T, order>::value)
+        {
+            return order{key, 0};
+        }
+        else
+        {
+            return T(key);
+        }
+    }
+
+    template <typename T, typename Compare, size_t Size>
+    void lookup_test(unsigned int range)
+    {
+        ulib::sorted_static_vector<T, Size, Compare> vec;
+        std::vector<T> reference;
+
+        for (size_t size = 0; size <= Size; ++size)
+        {
+            for (T key = T(0); key < T(range); key = key + T(1))
+            {
+                [[maybe_unused]] const auto lower = std::lower_bound(reference.begin(), reference.end(), key, Compare());
+                [[maybe_unused]] const auto upper = std::upper_bound(reference.begin(), reference.end(), key, Compare());
+                assert(vec.lower_bound(key) - vec.begin() == lower - reference.begin());
+                assert(vec.upper_bound(key) - vec.begin() == upper - reference.begin());
+                assert(vec.contains(key) == (lower != upper));
+                assert(vec.find(key) == (lower != upper ? vec.begin() + (lower - reference.begin()) : vec.end()));
+            }
+
+            if (size != Size)
+            {
+                const T val = T((myrand() >> 8) % range);
+                vec.emplace_binary(val);
+                reference.insert(std::upper_bound(reference.begin(), reference.end(), val, Compare()), val);
+            }
+        }
+    }
+
+    void order_lookup_test()
+    {
+        ulib::sorted_static_vector<order, 100, order_compare> vec;
+        for (int i = 0; i < 100; ++i)
+        {
+            vec.emplace_binary(order{2 * (i / 2), i});
+        }
+
+        assert(vec.find(7) == vec.end());
+        assert(!vec.contains(7));
+        assert(vec.find(8)->quantity == 8);
+        assert(vec.lower_bound(8) - vec.begin() == 8);
+        assert(vec.upper_bound(8) - vec.begin() == 10);
+        assert(vec.lower_bound(-1) == vec.begin());
+        assert(vec.upper_bound(1000) == vec.end());
+
+        [[maybe_unused]] const auto &cvec = vec;
+        assert(cvec.find(98) == cvec.begin() + 98);
+    }
+
+    // orders by price, equal prices by arrival (quantity holds the arrival number)
+    bool arrival_order(const order &a, const order &b)
+    {
+        return a.price != b.price ? a.price < b.price : a.quantity < b.quantity;
+    }
+
+    // bulk operations against single insertions, including the order of equal prices
+    void bulk_test()
+    {
+        using vector_type = ulib::sorted_static_vector<order, 100, order_compare>;
+        int arrival = 0;
+
+        for (unsigned int round = 0; round < 1000; ++round)
+        {
+            vector_type bulk;
+            vector_type single;
+
+            const size_t initial = (myrand() >> 8) % 60;
+            std::vector<order> sorted;
+            for (size_t i = 0; i < initial; ++i)
+            {
+                sorted.push_back(order{int((myrand() >> 8) % 30), arrival++});
+            }
+            std::sort(sorted.begin(), sorted.end(), arrival_order);
+            const size_t assigned = bulk.assign_sorted(sorted.begin(), sorted.end());
+            assert(assigned == initial);
+            (void)assigned;
+            for (const auto &elem : sorted)
+            {
+                single.emplace(elem);
+            }
+
+            // more than fits, the rest is refused
+            std::vector<order> batch((myrand() >> 8) % 60);
+            for (auto &elem : batch)
+            {
+                elem = order{int((myrand() >> 8) % 30), arrival++};
+            }
+            const size_t taken = bulk.insert_range(batch.begin(), batch.end());
+            assert(taken == std::min(batch.size(), size_t(100) - initial));
+            for (size_t i = 0; i < taken; ++i)
+            {
+                single.emplace(batch[i]);
+            }
+            assert(bulk.size() == single.size());
+            assert(std::equal(bulk.begin(), bulk.end(), single.begin(),
+                              [](const order &a, const order &b) { return a.price == b.price && a.quantity == b.quantity; }));
+            assert(std::is_sorted(bulk.begin(), bulk.end(), arrival_order));
+
+            ulib::sorted_static_vector<order, 50, order_compare> other;
+            for (size_t i = 0, count = (myrand() >> 8) % 50; i < count; ++i)
+            {
+                other.emplace_binary(order{int((myrand() >> 8) % 30), arrival++});
+            }
+            const size_t merged = bulk.merge(other);
+            assert(merged == std::min(size_t(other.size()), size_t(100) - taken - initial));
+            for (size_t i = 0; i < merged; ++i)
+            {
+                single.emplace(other[i]);
+            }
+            assert(std::equal(bulk.begin(), bulk.end(), single.begin(),
+                              [](const order &a, const order &b) { return a.price == b.price && a.quantity == b.quantity; }));
+        }
+
+        // merging a vector into itself puts each element next to its copy
+        ulib::sorted_static_vector<int, 8> self;
+        for (int val : {3, 1, 2, 5})
+        {
+            self.emplace(val);
+        }
+        [[maybe_unused]] const size_t doubled = self.merge(self);
+        [[maybe_unused]] const int expected[] = {1, 1, 2, 2, 3, 3, 5, 5};
+        assert(doubled == 4);
+        assert(std::equal(self.begin(), self.end(), std::begin(expected), std::end(expected)));
+
+        std::vector<int> unsorted{5, 3, 9, 1, 7, 3};
+        ulib::insertion_sort::insertion_sort(unsorted.begin(), unsorted.end());
+        assert(std::is_sorted(unsorted.begin(), unsorted.end()));
+        std::vector<int> unsorted_binary{5, 3, 9, 1, 7, 0};
+        ulib::insertion_sort::insertion_sort_binary(unsorted_binary.begin(), unsorted_binary.end());
+        assert(std::is_sorted(unsorted_binary.begin(), unsorted_binary.end()));
+    }
+
+    template <size_t Size, typename Load>
+    void load_benchmark(const char *name, const std::vector<int> &values, Load load)
+    {
+        constexpr unsigned int loads = 1 << 24;
+        const unsigned int rounds = unsigned(loads / Size);
+        ulib::sorted_static_vector<int, Size> vec;
+
+        size_t sum = 0;
+        auto begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int round = 0; round < rounds; ++round)
+        {
+            vec.clear();
+            load(vec, values);
+            sum += size_t(vec[round % Size]);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        std::cout << "  " << name << " " << Size << ": "
+                  << double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / (double(rounds) * Size)
+                  << "ns/element (" << sum << ")\n";
+    }
+
+    template <size_t Size>
+    void load_benchmarks()
+    {
+        using vector_type = ulib::sorted_static_vector<int, Size>;
+        std::vector<int> values(Size);
+        for (auto &value : values)
+        {
+            value = int(myrand());
+        }
+
+        load_benchmark<Size>("emplace       ", values, [](vector_type &vec, const std::vector<int> &vals) {
+            for (int val : vals)
+            {
+                vec.emplace(val);
+            }
+        });
+        load_benchmark<Size>("emplace_binary", values, [](vector_type &vec, const std::vector<int> &vals) {
+            for (int val : vals)
+            {
+                vec.emplace_binary(val);
+            }
+        });
+        load_benchmark<Size>("insert_range  ", values, [](vector_type &vec, const std::vector<int> &vals) {
+            vec.insert_range(vals.begin(), vals.end());
+        });
+        // half of it present already, the other half comes in sorted
+        load_benchmark<Size>("merge (half)  ", values, [](vector_type &vec, const std::vector<int> &vals) {
+            ulib::sorted_static_vector<int, Size / 2> half;
+            half.insert_range(vals.begin() + Size / 2, vals.end());
+            vec.insert_range(vals.begin(), vals.begin() + Size / 2);
+            vec.merge(half);
+        });
+    }
+
+    // order with a client name, not trivially copyable
+    struct named_order
+    {
+        int price;
+        std::string client;
+    };
+
+    struct named_order_compare
+    {
+        bool operator()(const named_order &a, const named_order &b) const
+        {
+            return a.price < b.price;
+        }
+    };
+
+    // restore after changing arbitrary elements, for memmove and move based shifting
+    template <typename T, typename Compare, typename Make, typename Price>
+    void restore_test(Make make, Price price)
+    {
+        ulib::sorted_static_vector<T, 64, Compare> vec;
+        for (int i = 0; i < 64; ++i)
+        {
+            vec.emplace(make(int((myrand() >> 8) % 1000)));
+        }
+        assert(std::is_sorted(vec.begin(), vec.end(), Compare()));
+
+        for (unsigned int i = 0; i < 10000; ++i)
+        {
+            auto it = vec.begin() + (myrand() >> 8) % 64;
+            *it = make(int((myrand() >> 8) % 1000));
+            vec.restore(it);
+            assert(std::is_sorted(vec.begin(), vec.end(), Compare()));
+        }
+
+        int sum = 0;
+        for (const auto &elem : vec)
+        {
+            sum += price(elem);
+        }
+        assert(sum >= 0);
+    }
+
+    // the swap chain shifting used before, for comparison
+    template <typename Iterator, typename Compare>
+    void swap_restore(Iterator begin, Iterator end, Iterator elem, Compare compare)
+    {
+        while (elem != begin && compare(*elem, *(elem - 1)))
+        {
+            std::swap(*(elem - 1), *elem);
+            --elem;
+        }
+        while (elem + 1 != end && compare(*(elem + 1), *elem))
+        {
+            std::swap(*(elem + 1), *elem);
+            ++elem;
+        }
+    }
+
+    // reprices a random order of a full book and restores the order, once by swapping and once through the hole
+    template <typename T, typename Compare, size_t Size, typename Make>
+    void restore_benchmark(const char *type, Make make)
+    {
+        constexpr unsigned int updates = 1 << 20;
+        ulib::sorted_static_vector<T, Size, Compare> vec;
+        for (size_t i = 0; i < Size; ++i)
+        {
+            vec.emplace_binary(make(int((myrand() >> 8) % 100000)));
+        }
+
+        std::vector<std::pair<size_t, int>> changes(4096);
+        for (auto &change : changes)
+        {
+            change = std::make_pair(size_t((myrand() >> 8) % Size), int((myrand() >> 8) % 100000));
+        }
+
+        auto begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int i = 0; i < updates; ++i)
+        {
+            const auto &change = changes[i & 4095];
+            vec[change.first].price = change.second;
+            swap_restore(vec.begin(), vec.end(), vec.begin() + change.first, Compare());
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        const double swapping = double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / updates;
+
+        begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int i = 0; i < updates; ++i)
+        {
+            const auto &change = changes[i & 4095];
+            vec[change.first].price = change.second;
+            vec.restore(vec.begin() + change.first);
+        }
+        end = std::chrono::high_resolution_clock::now();
+        const double shifting = double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / updates;
+
+        assert(std::is_sorted(vec.begin(), vec.end(), Compare()));
+        std::cout << "  " << type << " " << Size << ": swap " << swapping << "ns, hole " << shifting << "ns\n";
+    }
+
+    template <size_t Size>
+    void restore_benchmarks()
+    {
+        restore_benchmark<order, order_compare, Size>("order      ", [](int price) { return order{price, 0}; });
+        restore_benchmark<named_order, named_order_compare, Size>("named_order", [](int price) {
+            return named_order{price, "client"};
+        });
+    }
+
+    template <typename T, size_t Size, typename Compare, typename Lookup>
+    void lookup_benchmark(const char *name, const std::vector<int> &keys, Lookup lookup)
+    {
+        constexpr unsigned int lookups = 1 << 22;
+        ulib::sorted_static_vector<T, Size, Compare> vec;
+        for (size_t i = 0; i < Size; ++i)
+        {
+            vec.emplace_binary(keyed<T>(int(2 * i)));
+        }
+
+        size_t sum = 0;
+        auto begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int i = 0; i < lookups; ++i)
+        {
+            // the previous result feeds into the next key, so lookups cannot overlap
+            sum += size_t(lookup(vec, keys[(i + (sum & 1)) & 4095]) - vec.begin());
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        std::cout << name << " " << Size << ": "
+                  << double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / lookups << "ns/lookup (" << sum
+                  << ")\n";
+    }
+
+    template <typename T, size_t Size, typename Compare>
+    void lookup_benchmarks(const char *type)
+    {
+        using vector_type = ulib::sorted_static_vector<T, Size, Compare>;
+        std::vector<int> keys(4096);
+        for (auto &key : keys)
+        {
+            key = int((myrand() >> 8) % (2 * Size));
+        }
+
+        std::cout << type << ":\n";
+        lookup_benchmark<T, Size, Compare>("  std::find_if   ", keys, [](const vector_type &vec, int key) {
+            return std::find_if(vec.begin(), vec.end(), [&](const T &x) { return !Compare()(x, keyed<T>(key)); });
+        });
+        lookup_benchmark<T, Size, Compare>("  std::lower_bound", keys, [](const vector_type &vec, int key) {
+            return std::lower_bound(vec.begin(), vec.end(), keyed<T>(key), Compare());
+        });
+        lookup_benchmark<T, Size, Compare>("  lower_bound     ", keys, [](const vector_type &vec, int key) { return vec.lower_bound(keyed<T>(key)); });
+    }
+
+    template <size_t Size>
+    void lookup_benchmarks()
+    {
+        lookup_benchmarks<int, Size, std::less<int>>("int");
+        lookup_benchmarks<order, Size, order_compare>("order");
+    }
 } // namespace
 
 void sorted_static_vector_test()
@@ -30,6 +449,36 @@ void sorted_static_vector_test()
 
     std::cout << "Sorted Vector test:\n\n";
 
+    replace_test();
+    lookup_test<int, std::less<int>, 70>(100);
+    lookup_test<unsigned int, std::greater<unsigned int>, 70>(100);
+    lookup_test<float, std::less<float>, 70>(100);
+    lookup_test<short, std::less<short>, 70>(100);
+    order_lookup_test();
+    bulk_test();
+    restore_test<order, order_compare>([](int price) { return order{price, 0}; }, [](const order &o) { return o.price; });
+    restore_test<named_order, named_order_compare>([](int price) { return named_order{price, std::to_string(price)}; },
+                                                   [](const named_order &o) { return o.price; });
+
+    std::cout << "Restore after repricing:\n";
+    restore_benchmarks<64>();
+    restore_benchmarks<512>();
+    restore_benchmarks<4096>();
+
+    std::cout << "Bulk loading:\n";
+    load_benchmarks<16>();
+    load_benchmarks<64>();
+    load_benchmarks<512>();
+    load_benchmarks<4096>();
+
+    std::cout << "Lookup:\n";
+    lookup_benchmarks<8>();
+    lookup_benchmarks<32>();
+    lookup_benchmarks<128>();
+    lookup_benchmarks<512>();
+    lookup_benchmarks<4096>();
+    std::cout << "\n";
+
     auto begin = std::chrono::high_resolution_clock::now();
 
     for (unsigned int i = 0; i < 10000000; ++i)
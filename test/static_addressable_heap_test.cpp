@@ -0,0 +1,266 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "static_addressable_heap_test.hpp"
+#include "stdafx.h"
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <microlib/static_addressable_heap.hpp>
+#include <microlib/static_heap.hpp>
+#include <vector>
+
+namespace
+{
+    unsigned int a = 1140671485;
+    unsigned int c = 12820163;
+    unsigned int seed = 123541236;
+
+    unsigned int myrand()
+    {
+        return seed = ((seed * a + c) & 0xFFFFFF);
+    }
+
+    // A capacity at the limit of its size type still needs a free value for invalid_handle.
+    template <size_t Size>
+    void full_capacity_test()
+    {
+        using heap_type = ulib::static_addressable_heap<unsigned int, Size>;
+        static heap_type heap;
+
+        for (unsigned int i = 0; i < Size; ++i)
+        {
+            [[maybe_unused]] const auto h = heap.push(Size - i);
+            assert(h != heap_type::invalid_handle && heap.get(h) == Size - i);
+        }
+        [[maybe_unused]] const auto overflow = heap.push(0u);
+        assert(overflow == heap_type::invalid_handle && heap.size() == Size);
+
+        for (unsigned int i = 1; i <= Size; ++i)
+        {
+            assert(heap.top_element() == i);
+            heap.pop();
+        }
+    }
+
+    // Random pushes, pops, erases and updates through handles, checked against a map of live handles.
+    template <size_t Arity>
+    void handle_test()
+    {
+        using heap_type = ulib::static_addressable_heap<unsigned int, 500, std::less<unsigned int>, Arity>;
+        static heap_type heap;
+        std::map<typename heap_type::handle, unsigned int> live;
+
+        for (unsigned int i = 0; i < 20000; ++i)
+        {
+            const unsigned int op = myrand() % 8;
+            if (op < 3)
+            {
+                const unsigned int val = myrand() % 1000;
+                const auto h = heap.push(val);
+                assert((h == heap_type::invalid_handle) == (live.size() == heap.capacity()));
+                if (h != heap_type::invalid_handle)
+                {
+                    assert(!live.count(h));
+                    live[h] = val;
+                }
+            }
+            else if (live.empty())
+            {
+                continue;
+            }
+            else if (op < 4)
+            {
+                const auto top = heap.top_handle();
+                for ([[maybe_unused]] auto &entry : live)
+                {
+                    assert(heap.get(top) <= entry.second);
+                }
+                live.erase(top);
+                heap.pop();
+                assert(!heap.contains(top));
+            }
+            else
+            {
+                auto it = live.begin();
+                std::advance(it, myrand() % live.size());
+                assert(heap.contains(it->first) && heap.get(it->first) == it->second);
+                if (op < 6)
+                {
+                    heap.erase(it->first);
+                    assert(!heap.contains(it->first));
+                    live.erase(it);
+                }
+                else if (op < 7)
+                {
+                    it->second = myrand() % 1000;
+                    heap.update(it->first, it->second);
+                }
+                else
+                {
+                    it->second = myrand() % 1000;
+                    heap.get(it->first) = it->second;
+                    heap.update(it->first);
+                }
+            }
+            assert(heap.size() == live.size());
+            assert(heap.test_invariant());
+        }
+        heap.clear();
+    }
+
+    //
+    // Dijkstra on a random graph: decrease-key through handles against the usual workaround for heaps
+    // without it, pushing duplicates and skipping stale entries on pop (lazy deletion).
+
+    constexpr unsigned int nodes = 1 << 14;
+    constexpr unsigned int degree = 8;
+    constexpr uint32_t unreached = uint32_t(-1);
+
+    struct edge
+    {
+        uint32_t to;
+        uint32_t weight;
+    };
+
+    struct entry
+    {
+        uint32_t distance;
+        uint32_t node;
+    };
+
+    struct entry_less
+    {
+        bool operator()(const entry &lhs, const entry &rhs) const
+        {
+            return lhs.distance < rhs.distance;
+        }
+    };
+
+    edge graph[nodes][degree];
+    uint32_t distance[nodes];
+
+    void dijkstra_addressable()
+    {
+        using heap_type = ulib::static_addressable_heap<entry, nodes, entry_less, 4>;
+        static heap_type heap;
+        static heap_type::handle handles[nodes];
+
+        for (unsigned int n = 0; n < nodes; ++n)
+        {
+            distance[n] = unreached;
+            handles[n] = heap_type::invalid_handle;
+        }
+
+        distance[0] = 0;
+        handles[0] = heap.push(entry{0, 0});
+        while (heap.size())
+        {
+            const entry current = heap.top_element();
+            heap.pop();
+            handles[current.node] = heap_type::invalid_handle;
+
+            for (const edge &e : graph[current.node])
+            {
+                const uint32_t candidate = current.distance + e.weight;
+                if (candidate < distance[e.to])
+                {
+                    distance[e.to] = candidate;
+                    if (handles[e.to] == heap_type::invalid_handle)
+                    {
+                        handles[e.to] = heap.push(entry{candidate, e.to});
+                    }
+                    else
+                    {
+                        heap.update(handles[e.to], entry{candidate, e.to});
+                    }
+                }
+            }
+        }
+    }
+
+    void dijkstra_lazy()
+    {
+        static ulib::static_heap<entry, nodes * degree, entry_less, 4> heap;
+
+        for (unsigned int n = 0; n < nodes; ++n)
+        {
+            distance[n] = unreached;
+        }
+
+        distance[0] = 0;
+        heap.push(entry{0, 0});
+        while (heap.size())
+        {
+            const entry current = heap.top_element();
+            heap.pop();
+            if (current.distance != distance[current.node])
+            {
+                continue;
+            }
+
+            for (const edge &e : graph[current.node])
+            {
+                const uint32_t candidate = current.distance + e.weight;
+                if (candidate < distance[e.to])
+                {
+                    distance[e.to] = candidate;
+                    heap.push(entry{candidate, e.to});
+                }
+            }
+        }
+    }
+
+    template <typename Run>
+    double measure(Run run, uint64_t &checksum)
+    {
+        constexpr unsigned int rounds = 20;
+        auto begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int round = 0; round < rounds; ++round)
+        {
+            run();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        checksum = 0;
+        for (auto d : distance)
+        {
+            checksum += d;
+        }
+        return double(std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()) / rounds;
+    }
+
+} // namespace
+
+void static_addressable_heap_test()
+{
+    std::cout << "Addressable heap test:\n\n";
+
+    handle_test<2>();
+    handle_test<4>();
+    full_capacity_test<255>();
+    full_capacity_test<65535>();
+
+    for (auto &edges : graph)
+    {
+        for (auto &e : edges)
+        {
+            // the low bits of myrand() cycle quickly, use the high ones
+            e = edge{(myrand() >> 8) % nodes, 1 + (myrand() >> 8) % 1000};
+        }
+    }
+
+    uint64_t addressable_checksum;
+    uint64_t lazy_checksum;
+    const double addressable = measure(dijkstra_addressable, addressable_checksum);
+    const double lazy = measure(dijkstra_lazy, lazy_checksum);
+    assert(addressable_checksum == lazy_checksum);
+
+    std::cout << "Dijkstra, " << nodes << " nodes, " << nodes * degree << " edges\n";
+    std::cout << "decrease-key us: " << addressable << "\n";
+    std::cout << "lazy delete us:  " << lazy << "\n\n";
+}
@@ -0,0 +1,11 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MICROLIB_TEST_STATIC_ADDRESSABLE_HEAP_TEST_HPP__
+#define MICROLIB_TEST_STATIC_ADDRESSABLE_HEAP_TEST_HPP__
+
+void static_addressable_heap_test();
+
+#endif
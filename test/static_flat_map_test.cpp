@@ -0,0 +1,405 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "static_flat_map_test.hpp"
+#include "stdafx.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <microlib/sorted_static_vector.hpp>
+#include <microlib/static_flat_map.hpp>
+#include <microlib/static_flat_set.hpp>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    unsigned int a = 1140671485;
+    unsigned int c = 12820163;
+    unsigned int seed = 123541236;
+
+    unsigned int myrand()
+    {
+        return seed = ((seed * a + c) & 0xFFFFFF);
+    }
+
+    template <typename FlatMap, typename Map>
+    void check_equal(const FlatMap &flat, const Map &map)
+    {
+        assert(flat.size() == map.size());
+        assert(std::is_sorted(flat.key_data(), flat.key_data() + flat.size()));
+        auto it = map.begin();
+        for ([[maybe_unused]] auto [key, value] : flat)
+        {
+            assert(key == it->first);
+            assert(value == it->second);
+            ++it;
+        }
+    }
+
+    // random operations against std::map, with a mapped type that is not trivially copyable
+    template <size_t Size>
+    void map_reference_test()
+    {
+        ulib::static_flat_map<int, std::string, Size> flat;
+        std::map<int, std::string> map;
+
+        for (unsigned int step = 0; step < 20000; ++step)
+        {
+            const int key = int((myrand() >> 8) % (2 * Size));
+            const std::string value = std::to_string(myrand());
+            switch ((myrand() >> 8) % 4)
+            {
+            case 0:
+            {
+                [[maybe_unused]] const auto result = flat.try_emplace(key, value);
+                if (map.size() == Size && !map.count(key))
+                {
+                    assert(!result.second && result.first == flat.end());
+                }
+                else
+                {
+                    [[maybe_unused]] const bool inserted = map.emplace(key, value).second;
+                    assert(result.second == inserted);
+                    assert(result.first.key() == key && result.first.value() == map[key]);
+                }
+                break;
+            }
+            case 1:
+            {
+                [[maybe_unused]] const auto result = flat.insert_or_assign(key, value);
+                if (map.size() < Size || map.count(key))
+                {
+                    assert(result.second == !map.count(key));
+                    map[key] = value;
+                    assert(result.first.value() == value);
+                }
+                else
+                {
+                    assert(!result.second && result.first == flat.end());
+                }
+                break;
+            }
+            case 2:
+            {
+                [[maybe_unused]] const size_t erased = flat.erase(key);
+                [[maybe_unused]] const size_t expected = map.erase(key);
+                assert(erased == expected);
+                break;
+            }
+            default:
+            {
+                const auto it = flat.lower_bound(key);
+                if (it != flat.end())
+                {
+                    const int erased = it.key();
+                    [[maybe_unused]] const auto next = flat.erase(it);
+                    map.erase(erased);
+                    assert(next == flat.lower_bound(erased));
+                }
+                break;
+            }
+            }
+
+            [[maybe_unused]] const auto found = map.find(key);
+            [[maybe_unused]] const auto &cflat = flat;
+            assert(flat.contains(key) == (found != map.end()));
+            assert(found == map.end() ? cflat.find(key) == cflat.end() && !cflat.get(key) : *cflat.get(key) == found->second);
+            [[maybe_unused]] const auto lower = map.lower_bound(key);
+            [[maybe_unused]] const auto upper = map.upper_bound(key);
+            assert(lower == map.end() ? cflat.lower_bound(key) == cflat.end() : cflat.lower_bound(key).key() == lower->first);
+            assert(upper == map.end() ? cflat.upper_bound(key) == cflat.end() : cflat.upper_bound(key).key() == upper->first);
+
+            if (step % 1000 == 0)
+            {
+                check_equal(flat, map);
+            }
+        }
+        check_equal(flat, map);
+    }
+
+    // bulk construction from unsorted input with repeated keys: the first occurrence wins, like std::map::insert
+    template <size_t Size>
+    void map_assign_test()
+    {
+        for (size_t count = 0; count <= Size + 10; ++count)
+        {
+            std::vector<std::pair<int, std::string>> input;
+            for (size_t i = 0; i < count; ++i)
+            {
+                input.emplace_back(int((myrand() >> 8) % (count + 1)), std::to_string(i));
+            }
+
+            const ulib::static_flat_map<int, std::string, Size> flat(input.begin(), input.end());
+            std::map<int, std::string> map;
+            map.insert(input.begin(), input.begin() + std::min(count, Size));
+            check_equal(flat, map);
+        }
+    }
+
+    void heterogeneous_test()
+    {
+        const std::vector<std::pair<std::string, int>> input{{"pear", 1}, {"apple", 2}, {"fig", 3}, {"apple", 4}, {"banana", 5}};
+        ulib::static_flat_map<std::string, int, 8, std::less<>> map(input.begin(), input.end());
+        assert(map.size() == 4);
+        assert(*map.get(std::string_view("apple")) == 2);
+        assert(map.contains("fig") && !map.contains("grape"));
+        assert(map.lower_bound(std::string_view("c")).key() == "fig");
+
+        // the key is only converted to std::string when it is inserted
+        [[maybe_unused]] bool inserted = map.try_emplace(std::string_view("pear"), 7).second;
+        assert(!inserted);
+        inserted = map.try_emplace(std::string_view("cherry"), 7).second;
+        assert(inserted && *map.get("cherry") == 7);
+        [[maybe_unused]] size_t erased = map.erase("banana");
+        assert(erased == 1);
+        erased = map.erase("banana");
+        assert(erased == 0);
+
+        const std::vector<std::string> names{"b", "a", "c", "a"};
+        ulib::static_flat_set<std::string, 8, std::less<>> set(names.begin(), names.end());
+        assert(set.size() == 3 && *set.begin() == "a");
+        assert(set.contains(std::string_view("c")) && set.find("d") == set.end());
+        inserted = set.insert(std::string_view("d")).second;
+        assert(inserted);
+        inserted = set.insert("a").second;
+        assert(!inserted);
+        erased = set.erase(std::string_view("b"));
+        assert(erased == 1 && set.size() == 3);
+    }
+
+    struct first_less
+    {
+        bool operator()(const std::pair<int, int> &a, const std::pair<int, int> &b) const
+        {
+            return a.first < b.first;
+        }
+    };
+
+    // bulk construction of a set whose equivalent keys are distinguishable: the first occurrence wins
+    template <size_t Size>
+    void set_assign_test()
+    {
+        for (size_t count = 0; count <= Size + 10; ++count)
+        {
+            std::vector<std::pair<int, int>> input;
+            for (size_t i = 0; i < count; ++i)
+            {
+                input.emplace_back(int((myrand() >> 8) % (count + 1)), int(i));
+            }
+
+            const ulib::static_flat_set<std::pair<int, int>, Size, first_less> flat(input.begin(), input.end());
+            std::set<std::pair<int, int>, first_less> set;
+            set.insert(input.begin(), input.begin() + std::min(count, Size));
+            assert(std::equal(flat.begin(), flat.end(), set.begin(), set.end()));
+        }
+    }
+
+    // random operations against std::set
+    template <size_t Size>
+    void set_reference_test()
+    {
+        ulib::static_flat_set<int, Size> flat;
+        std::set<int> set;
+
+        for (unsigned int step = 0; step < 20000; ++step)
+        {
+            const int key = int((myrand() >> 8) % (2 * Size));
+            if ((myrand() >> 8) % 2)
+            {
+                [[maybe_unused]] const auto result = flat.insert(key);
+                if (set.size() == Size && !set.count(key))
+                {
+                    assert(!result.second && result.first == flat.end());
+                }
+                else
+                {
+                    [[maybe_unused]] const bool inserted = set.insert(key).second;
+                    assert(result.second == inserted);
+                    assert(*result.first == key);
+                }
+            }
+            else
+            {
+                [[maybe_unused]] const size_t erased = flat.erase(key);
+                [[maybe_unused]] const size_t expected = set.erase(key);
+                assert(erased == expected);
+            }
+
+            assert(flat.contains(key) == (set.count(key) != 0));
+            [[maybe_unused]] const auto lower = set.lower_bound(key);
+            assert(lower == set.end() ? flat.lower_bound(key) == flat.end() : *flat.lower_bound(key) == *lower);
+            assert(std::equal(flat.begin(), flat.end(), set.begin(), set.end()));
+        }
+
+        std::vector<int> input;
+        for (size_t i = 0; i < 3 * Size; ++i)
+        {
+            input.push_back(int((myrand() >> 8) % (2 * Size)));
+        }
+        flat.assign(input.begin(), input.end());
+        set.clear();
+        set.insert(input.begin(), input.begin() + Size);
+        assert(std::equal(flat.begin(), flat.end(), set.begin(), set.end()));
+        if (!flat.empty())
+        {
+            [[maybe_unused]] const auto next = flat.erase(flat.begin());
+            assert(next == flat.begin());
+        }
+    }
+
+    // 32 byte payload, the case structure of arrays is made for
+    struct payload
+    {
+        int data[8];
+    };
+
+    struct pair_compare
+    {
+        bool operator()(const std::pair<int, payload> &a, const std::pair<int, payload> &b) const
+        {
+            return a.first < b.first;
+        }
+    };
+
+    template <typename Container, typename Lookup>
+    void lookup_benchmark(const char *name, const Container &container, const std::vector<int> &keys, Lookup lookup)
+    {
+        constexpr unsigned int lookups = 1 << 22;
+
+        // independent lookups, which may overlap
+        size_t sum = 0;
+        auto begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int i = 0; i < lookups; ++i)
+        {
+            sum += size_t(lookup(container, keys[i & 4095]));
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        const double throughput = double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / lookups;
+
+        // the previous result feeds into the next key, so lookups cannot overlap
+        begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int i = 0; i < lookups; ++i)
+        {
+            sum += size_t(lookup(container, keys[((i + unsigned(sum)) * 2654435761u) >> 20]));
+        }
+        end = std::chrono::high_resolution_clock::now();
+        const double latency = double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / lookups;
+
+        std::cout << name << ": " << throughput << "ns/lookup independent, " << latency << "ns/lookup dependent (" << sum << ")\n";
+    }
+
+    template <typename Build>
+    void build_benchmark(const char *name, size_t size, Build build)
+    {
+        constexpr unsigned int elements = 1 << 22;
+        const unsigned int rounds = unsigned(elements / size);
+
+        size_t sum = 0;
+        auto begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int round = 0; round < rounds; ++round)
+        {
+            sum += build();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        std::cout << name << ": "
+                  << double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / (double(rounds) * size)
+                  << "ns/element (" << sum << ")\n";
+    }
+
+    template <size_t Size>
+    void benchmarks()
+    {
+        using pair_type = std::pair<int, payload>;
+        using std_map_type = std::map<int, payload>;
+        using pair_vector_type = ulib::sorted_static_vector<pair_type, Size, pair_compare>;
+        using flat_map_type = ulib::static_flat_map<int, payload, Size>;
+
+        // even keys in random order, looked up with even and odd keys
+        std::vector<pair_type> input;
+        for (size_t i = 0; i < Size; ++i)
+        {
+            input.push_back(pair_type(int(2 * i), payload{{int(2 * i)}}));
+        }
+        for (size_t i = Size; i > 1; --i)
+        {
+            std::swap(input[i - 1], input[(myrand() >> 8) % i]);
+        }
+
+        std::vector<int> keys(4096);
+        for (auto &key : keys)
+        {
+            key = int((myrand() >> 8) % (2 * Size));
+        }
+
+        const std_map_type std_map(input.begin(), input.end());
+        auto pair_vector = std::make_unique<pair_vector_type>();
+        pair_vector->insert_range(input.begin(), input.end());
+        auto flat_map = std::make_unique<flat_map_type>(input.begin(), input.end());
+
+        // all report the payload found (or the key itself), so the sums must agree
+        std::cout << "payload " << Size << ":\n";
+        lookup_benchmark("  std::map         ", std_map, keys, [](const std_map_type &map, int key) {
+            const auto it = map.find(key);
+            return it != map.end() ? it->second.data[0] : key;
+        });
+        lookup_benchmark("  sorted pairs     ", *pair_vector, keys, [](const pair_vector_type &vec, int key) {
+            const auto it = vec.find(pair_type(key, payload()));
+            return it != vec.end() ? it->second.data[0] : key;
+        });
+        lookup_benchmark("  static_flat_map  ", *flat_map, keys, [](const flat_map_type &map, int key) {
+            const payload *value = map.get(key);
+            return value ? value->data[0] : key;
+        });
+
+        build_benchmark("  std::map build   ", Size, [&] {
+            const std_map_type map(input.begin(), input.end());
+            return size_t(map.rbegin()->second.data[0]);
+        });
+        build_benchmark("  sorted pairs build", Size, [&] {
+            pair_vector->clear();
+            pair_vector->insert_range(input.begin(), input.end());
+            return size_t((*pair_vector)[Size - 1].second.data[0]);
+        });
+        build_benchmark("  static_flat_map build", Size, [&] {
+            flat_map->assign(input.begin(), input.end());
+            return size_t(flat_map->value_data()[Size - 1].data[0]);
+        });
+    }
+
+} // namespace
+
+void static_flat_map_test()
+{
+    std::cout << "Static flat map test:\n\n";
+
+    map_reference_test<1>();
+    map_reference_test<16>();
+    map_reference_test<300>();
+    map_assign_test<1>();
+    map_assign_test<40>();
+    map_assign_test<300>();
+    heterogeneous_test();
+    set_assign_test<1>();
+    set_assign_test<40>();
+    set_assign_test<300>();
+    set_reference_test<1>();
+    set_reference_test<16>();
+    set_reference_test<300>();
+
+    benchmarks<64>();
+    benchmarks<512>();
+    benchmarks<4096>();
+
+    std::cout << "\n";
+}
@@ -7,11 +7,341 @@
 #include "stdafx.h"
 #include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
 #include <iostream>
+#include <memory>
 #include <microlib/static_heap.hpp>
 #include <set>
 #include <vector>
 
+namespace
+{
+    unsigned int a = 1140671485;
+    unsigned int c = 12820163;
+    unsigned int seed = 123541236;
+
+    unsigned int myrand()
+    {
+        return seed = ((seed * a + c) & 0xFFFFFF);
+    }
+
+    // Random pushes, pops, erases and in-place changes, checked against std::multiset.
+    template <size_t Arity>
+    void dary_test()
+    {
+        static ulib::static_heap<unsigned int, 1000, std::less<unsigned int>, Arity> heap;
+        std::multiset<unsigned int> reference;
+
+        for (unsigned int i = 0; i < 20000; ++i)
+        {
+            const unsigned int op = myrand() % 8;
+            if (op < 4 && heap.size() != heap.capacity())
+            {
+                const unsigned int val = myrand() % 1000;
+                heap.push(val);
+                reference.insert(val);
+            }
+            else if (op < 5 && heap.size())
+            {
+                assert(heap.top_element() == *reference.begin());
+                reference.erase(reference.begin());
+                heap.pop();
+            }
+            else if (op < 6 && heap.size())
+            {
+                auto it = heap.begin() + myrand() % heap.size();
+                reference.erase(reference.find(*it));
+                heap.erase(it);
+            }
+            else if (heap.size())
+            {
+                auto it = heap.begin() + myrand() % heap.size();
+                reference.erase(reference.find(*it));
+                *it = myrand() % 1000;
+                reference.insert(*it);
+                heap.restore(it);
+            }
+            assert(heap.test_invariant());
+        }
+
+        while (heap.size())
+        {
+            assert(heap.top_element() == *reference.begin());
+            reference.erase(reference.begin());
+            heap.pop();
+        }
+    }
+
+    // assign() and push_range() on both paths (rebuild and incremental), checked by draining.
+    template <size_t Arity>
+    void bulk_test()
+    {
+        static ulib::static_heap<unsigned int, 1000, std::less<unsigned int>, Arity> heap;
+        std::vector<unsigned int> values;
+
+        for (unsigned int round = 0; round < 200; ++round)
+        {
+            std::vector<unsigned int> batch(myrand() % 1200);
+            for (auto &val : batch)
+            {
+                val = myrand() % 500;
+            }
+
+            if (round % 3 == 0)
+            {
+                values.clear();
+                heap.assign(batch.begin(), batch.end());
+            }
+            else
+            {
+                heap.push_range(batch.begin(), batch.end());
+            }
+            values.insert(values.end(), batch.begin(), batch.begin() + (heap.size() - values.size()));
+            assert(heap.test_invariant());
+
+            // drain some, keep the rest for the next round
+            std::sort(values.begin(), values.end());
+            const size_t keep = myrand() % (values.size() + 1);
+            while (heap.size() > keep)
+            {
+                assert(heap.top_element() == values.front());
+                values.erase(values.begin());
+                heap.pop();
+            }
+        }
+    }
+
+    // clear() followed by pushes, the size of these heaps lives in the spare slots in front of the root.
+    // Optimized builds once broke this (see static_vector_storage), so the result is printed as well,
+    // which keeps the check alive without asserts.
+    template <size_t Arity>
+    void clear_test()
+    {
+        ulib::static_heap<uint32_t, 300, std::less<uint32_t>, Arity> heap;
+        std::vector<uint32_t> values;
+        size_t sum = 0;
+
+        for (unsigned int round = 0; round < 50; ++round)
+        {
+            heap.clear();
+            values.clear();
+            assert(heap.size() == 0);
+
+            const size_t count = 1 + myrand() % heap.capacity();
+            for (size_t i = 0; i < count; ++i)
+            {
+                const uint32_t val = myrand();
+                const bool pushed = heap.push(val);
+                assert(pushed);
+                (void)pushed;
+                values.push_back(val);
+            }
+            assert(heap.size() == count);
+
+            std::sort(values.begin(), values.end());
+            for (size_t i = 0; i < count / 2; ++i)
+            {
+                assert(heap.top_element() == values[i]);
+                sum += heap.top_element();
+                heap.pop();
+            }
+        }
+        std::cout << "clear and push, arity " << Arity << ": " << sum << "\n";
+    }
+
+    constexpr unsigned int bench_size = 1 << 14;
+
+    double ns_per_op(std::chrono::high_resolution_clock::time_point begin, unsigned int ops)
+    {
+        auto end = std::chrono::high_resolution_clock::now();
+        return double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / ops;
+    }
+
+    // push-heavy: fill an empty heap, pop-heavy: drain a full one,
+    // hold: timer queue steady state, the earliest deadline gets rescheduled into the future.
+    template <size_t Arity>
+    void dary_benchmark()
+    {
+        constexpr unsigned int rounds = 20;
+        static ulib::static_heap<uint32_t, bench_size, std::less<uint32_t>, Arity> heap;
+
+        double push = 0;
+        double pop = 0;
+        for (unsigned int round = 0; round < rounds; ++round)
+        {
+            auto begin = std::chrono::high_resolution_clock::now();
+            for (unsigned int i = 0; i < bench_size; ++i)
+            {
+                heap.push(myrand());
+            }
+            push += ns_per_op(begin, bench_size);
+
+            begin = std::chrono::high_resolution_clock::now();
+            for (unsigned int i = 0; i < bench_size; ++i)
+            {
+                heap.pop();
+            }
+            pop += ns_per_op(begin, bench_size);
+        }
+
+        for (unsigned int i = 0; i < bench_size; ++i)
+        {
+            heap.push(myrand());
+        }
+        auto begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int i = 0; i < rounds * bench_size; ++i)
+        {
+            heap.replace(heap.top_element() + myrand() % (1 << 20));
+        }
+        const double hold = ns_per_op(begin, rounds * bench_size);
+        while (heap.size())
+        {
+            heap.pop();
+        }
+
+        std::cout << Arity << "-ary   push ns: " << push / rounds << "   pop ns: " << pop / rounds << "   hold ns: " << hold << "\n";
+    }
+
+    // Loading persisted timers into an empty heap: repeated push against assign(),
+    // once in random order and once in reverse order (every push sifts up to the root).
+    // Then push_range() of a batch twice as large as the heap against repeated push.
+    template <size_t Arity>
+    void bulk_benchmark()
+    {
+        constexpr unsigned int count = 1 << 15;
+        constexpr unsigned int rounds = 20;
+        static ulib::static_heap<uint32_t, 3 * count, std::less<uint32_t>, Arity> heap;
+        static uint32_t timers[2 * count];
+
+        double push[2] = {};
+        double assign[2] = {};
+        double push_range[2] = {};
+        for (unsigned int round = 0; round < rounds; ++round)
+        {
+            for (auto &timer : timers)
+            {
+                timer = myrand();
+            }
+
+            for (unsigned int order = 0; order < 2; ++order)
+            {
+                if (order == 1)
+                {
+                    std::sort(timers, timers + count, std::greater<uint32_t>());
+                }
+
+                heap.clear();
+                auto begin = std::chrono::high_resolution_clock::now();
+                for (unsigned int i = 0; i < count; ++i)
+                {
+                    heap.push(timers[i]);
+                }
+                push[order] += ns_per_op(begin, count);
+
+                begin = std::chrono::high_resolution_clock::now();
+                heap.assign(timers, timers + count);
+                assign[order] += ns_per_op(begin, count);
+            }
+
+            heap.assign(timers, timers + count / 2);
+            auto begin = std::chrono::high_resolution_clock::now();
+            for (unsigned int i = count; i < 2 * count; ++i)
+            {
+                heap.push(timers[i]);
+            }
+            push_range[0] += ns_per_op(begin, count);
+
+            heap.assign(timers, timers + count / 2);
+            begin = std::chrono::high_resolution_clock::now();
+            heap.push_range(timers + count, timers + 2 * count);
+            push_range[1] += ns_per_op(begin, count);
+        }
+
+        std::cout << Arity << "-ary   random: push " << push[0] / rounds << " assign " << assign[0] / rounds
+                  << "   reverse: push " << push[1] / rounds << " assign " << assign[1] / rounds << "   batch: push "
+                  << push_range[0] / rounds << " push_range " << push_range[1] / rounds << "\n";
+    }
+
+    // Same order as std::less, but hides the comparator from the SIMD kernels.
+    template <typename T>
+    struct scalar_less
+    {
+        bool operator()(const T &lhs, const T &rhs) const
+        {
+            return lhs < rhs;
+        }
+    };
+
+    // The kernels must pick the same child as a left to right scan, also among ties.
+    template <typename T, size_t Arity, typename Compare>
+    void simd_select_test()
+    {
+        using select = ulib::detail::heap_child_select<T, Arity, Compare>;
+        if constexpr (select::enabled)
+        {
+            Compare compare;
+            T group[Arity];
+            for (unsigned int i = 0; i < 10000; ++i)
+            {
+                size_t expected = 0;
+                for (size_t k = 0; k < Arity; ++k)
+                {
+                    // few distinct values to provoke ties, some negative ones for signed types
+                    group[k] = T(int(myrand() % 5) - 2) * T(1 + (i % 2) * 1000000000);
+                    expected = compare(group[k], group[expected]) ? k : expected;
+                }
+                assert(select::select(group) == expected);
+            }
+        }
+    }
+
+    template <typename T, size_t Arity>
+    void simd_select_test()
+    {
+        simd_select_test<T, Arity, std::less<T>>();
+        simd_select_test<T, Arity, std::greater<T>>();
+    }
+
+    template <typename Key>
+    Key random_key()
+    {
+        return Key(myrand()) * Key(1 << 20) + Key(myrand());
+    }
+
+    // 1M pushes followed by 1M pops
+    template <typename Key, size_t Arity, typename Compare>
+    void simd_benchmark(const char *name, const char *compare_name)
+    {
+        constexpr unsigned int count = 1 << 20;
+        std::unique_ptr<ulib::static_heap<Key, count, Compare, Arity>> heap(new ulib::static_heap<Key, count, Compare, Arity>);
+
+        auto begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            heap->push(random_key<Key>());
+        }
+        const double push = ns_per_op(begin, count);
+
+        begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            heap->pop();
+        }
+        const double pop = ns_per_op(begin, count);
+
+        std::cout << name << " " << Arity << "-ary " << compare_name << "   push ns: " << push << "   pop ns: " << pop << "\n";
+    }
+
+    template <typename Key, size_t Arity>
+    void simd_benchmark(const char *name)
+    {
+        simd_benchmark<Key, Arity, std::less<Key>>(name, ulib::detail::heap_child_select<Key, Arity, std::less<Key>>::enabled ? "simd  " : "scalar");
+        simd_benchmark<Key, Arity, scalar_less<Key>>(name, "scalar");
+    }
+
+} // namespace
+
 
 void static_heap_test()
 {
@@ -67,4 +397,47 @@ void static_heap_test()
         std::cout << "popping " << int(topref) << "\n";
         int_heap.pop();
     }
-}
\ No newline at end of file
+
+    dary_test<2>();
+    dary_test<3>();
+    dary_test<4>();
+    dary_test<8>();
+
+    std::cout << "\nd-ary heap benchmark, " << bench_size << " uint32 keys:\n";
+    dary_benchmark<2>();
+    dary_benchmark<4>();
+    dary_benchmark<8>();
+    std::cout << "\n";
+
+    bulk_test<2>();
+    bulk_test<4>();
+    bulk_test<8>();
+    clear_test<2>();
+    clear_test<3>();
+
+    std::cout << "Bulk load benchmark, ns per element:\n";
+    bulk_benchmark<2>();
+    bulk_benchmark<4>();
+    bulk_benchmark<8>();
+    std::cout << "\n";
+
+    simd_select_test<uint32_t, 4>();
+    simd_select_test<int32_t, 4>();
+    simd_select_test<float, 4>();
+    simd_select_test<uint32_t, 8>();
+    simd_select_test<int32_t, 8>();
+    simd_select_test<float, 8>();
+    simd_select_test<uint64_t, 4>();
+    simd_select_test<int64_t, 4>();
+    simd_select_test<uint64_t, 8>();
+    simd_select_test<int64_t, 8>();
+
+    std::cout << "Child selection benchmark:\n";
+    simd_benchmark<uint32_t, 4>("uint32");
+    simd_benchmark<uint32_t, 8>("uint32");
+    simd_benchmark<uint64_t, 4>("uint64");
+    simd_benchmark<uint64_t, 8>("uint64");
+    simd_benchmark<float, 4>("float ");
+    simd_benchmark<float, 8>("float ");
+    std::cout << "\n";
+}
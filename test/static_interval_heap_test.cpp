@@ -5,9 +5,13 @@
 
 #include "static_interval_heap_test.hpp"
 #include "stdafx.h"
+#include <algorithm>
+#include <cassert>
 #include <chrono>
+#include <cstdint>
 #include <iostream>
 #include <microlib/static_interval_heap.hpp>
+#include <vector>
 
 
 namespace
@@ -20,6 +24,110 @@ namespace
     {
         return seed = ((seed * a + c) & 0xFFFFFF);
     }
+
+    // assign() and push_range() on both paths, drained alternately from both ends.
+    void bulk_test()
+    {
+        static ulib::static_inverval_heap<int, 1000> heap;
+        std::vector<int> values;
+
+        for (unsigned int round = 0; round < 200; ++round)
+        {
+            std::vector<int> batch(myrand() % 1200);
+            for (auto &val : batch)
+            {
+                val = int(myrand() % 500);
+            }
+
+            if (round % 3 == 0)
+            {
+                values.clear();
+                heap.assign(batch.begin(), batch.end());
+            }
+            else
+            {
+                heap.push_range(batch.begin(), batch.end());
+            }
+            values.insert(values.end(), batch.begin(), batch.begin() + (heap.size() - values.size()));
+            assert(heap.test_invariant());
+
+            std::sort(values.begin(), values.end());
+            const size_t keep = myrand() % (values.size() + 1);
+            while (heap.size() > keep)
+            {
+                if (heap.size() % 2)
+                {
+                    assert(heap.min_element() == values.front());
+                    values.erase(values.begin());
+                    heap.pop_min();
+                }
+                else
+                {
+                    assert(heap.max_element() == values.back());
+                    values.pop_back();
+                    heap.pop_max();
+                }
+                assert(heap.test_invariant());
+            }
+        }
+    }
+
+    double ns_per_op(std::chrono::high_resolution_clock::time_point begin, unsigned int ops)
+    {
+        auto end = std::chrono::high_resolution_clock::now();
+        return double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / ops;
+    }
+
+    // Loading persisted timers into an empty heap: repeated push against assign(),
+    // then push_range() of a batch twice as large as the heap against repeated push.
+    void bulk_benchmark()
+    {
+        constexpr unsigned int count = 1 << 15;
+        constexpr unsigned int rounds = 20;
+        static ulib::static_inverval_heap<uint32_t, 3 * count> heap;
+        static uint32_t timers[2 * count];
+
+        double push = 0;
+        double assign = 0;
+        double batch_push = 0;
+        double push_range = 0;
+        for (unsigned int round = 0; round < rounds; ++round)
+        {
+            for (auto &timer : timers)
+            {
+                timer = myrand();
+            }
+
+            heap.clear();
+            auto begin = std::chrono::high_resolution_clock::now();
+            for (unsigned int i = 0; i < count; ++i)
+            {
+                heap.push(timers[i]);
+            }
+            push += ns_per_op(begin, count);
+
+            begin = std::chrono::high_resolution_clock::now();
+            heap.assign(timers, timers + count);
+            assign += ns_per_op(begin, count);
+
+            heap.assign(timers, timers + count / 2);
+            begin = std::chrono::high_resolution_clock::now();
+            for (unsigned int i = count; i < 2 * count; ++i)
+            {
+                heap.push(timers[i]);
+            }
+            batch_push += ns_per_op(begin, count);
+
+            heap.assign(timers, timers + count / 2);
+            begin = std::chrono::high_resolution_clock::now();
+            heap.push_range(timers + count, timers + 2 * count);
+            push_range += ns_per_op(begin, count);
+        }
+
+        std::cout << "Bulk load ns per element:  push " << push / rounds << " assign " << assign / rounds << "   batch: push "
+                  << batch_push / rounds << " push_range " << push_range / rounds << "\n\n";
+    }
+
 } // namespace
 
 void static_interval_heap_test()
@@ -30,6 +138,9 @@ void static_interval_heap_test()
 
     std::cout << "Interval Heap test:\n\n";
 
+    bulk_test();
+    bulk_benchmark();
+
     auto begin = std::chrono::high_resolution_clock::now();
 
     for (unsigned int i = 0; i < 10000000; ++i)
@@ -0,0 +1,301 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "static_minmax_heap_test.hpp"
+#include "stdafx.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <microlib/sorted_static_vector.hpp>
+#include <microlib/static_interval_heap.hpp>
+#include <microlib/static_minmax_heap.hpp>
+#include <set>
+#include <vector>
+
+namespace
+{
+    unsigned int a = 1140671485;
+    unsigned int c = 12820163;
+    unsigned int seed = 123541236;
+
+    unsigned int myrand()
+    {
+        return seed = ((seed * a + c) & 0xFFFFFF);
+    }
+
+    // Random operations against a std::multiset, for both double ended heaps.
+    template <typename Heap>
+    void reference_test()
+    {
+        static Heap heap;
+        std::multiset<int> reference;
+        heap.clear();
+
+        for (unsigned int i = 0; i < 200000; ++i)
+        {
+            const int val = int((myrand() >> 8) % 1000);
+            switch ((myrand() >> 8) % 10)
+            {
+            case 0:
+            case 1:
+            case 2:
+                if (heap.emplace(val))
+                {
+                    reference.insert(val);
+                }
+                else
+                {
+                    assert(reference.size() == heap.capacity());
+                }
+                break;
+            case 3:
+                if (heap.size())
+                {
+                    heap.pop_min();
+                    reference.erase(reference.begin());
+                }
+                break;
+            case 4:
+                if (heap.size())
+                {
+                    heap.pop_max();
+                    reference.erase(std::prev(reference.end()));
+                }
+                break;
+            case 5:
+                if (heap.size())
+                {
+                    heap.replace_min(val);
+                    reference.erase(reference.begin());
+                    reference.insert(val);
+                }
+                break;
+            case 6:
+                if (heap.size())
+                {
+                    heap.replace_max(val);
+                    reference.erase(std::prev(reference.end()));
+                    reference.insert(val);
+                }
+                break;
+            case 7:
+                if (heap.size())
+                {
+                    auto it = heap.begin() + (myrand() >> 8) % heap.size();
+                    reference.erase(reference.find(*it));
+                    heap.erase(it);
+                }
+                break;
+            case 8:
+                if (heap.size())
+                {
+                    auto it = heap.begin() + (myrand() >> 8) % heap.size();
+                    reference.erase(reference.find(*it));
+                    reference.insert(val);
+                    *it = val;
+                    [[maybe_unused]] const auto restored = heap.restore(it);
+                    assert(*restored == val);
+                }
+                break;
+            case 9:
+                if ((myrand() >> 8) % 50 == 0)
+                {
+                    std::vector<int> batch((myrand() >> 8) % (heap.capacity() + 1));
+                    for (auto &elem : batch)
+                    {
+                        elem = int((myrand() >> 8) % 1000);
+                    }
+                    if (myrand() & 0x100)
+                    {
+                        reference.clear();
+                        heap.assign(batch.begin(), batch.end());
+                    }
+                    else
+                    {
+                        heap.push_range(batch.begin(), batch.end());
+                    }
+                    reference.insert(batch.begin(), batch.begin() + (heap.size() - reference.size()));
+                }
+                break;
+            }
+
+            assert(heap.size() == reference.size());
+            if (heap.size())
+            {
+                assert(heap.min_element() == *reference.begin());
+                assert(heap.max_element() == *reference.rbegin());
+            }
+            assert(heap.test_invariant());
+        }
+    }
+
+    // both heaps and the sorted vector behind one interface
+    template <typename Heap>
+    struct heap_adaptor
+    {
+        Heap queue;
+
+        void push(uint32_t val)
+        {
+            queue.push(val);
+        }
+
+        uint32_t min()
+        {
+            return queue.min_element();
+        }
+
+        void pop_min()
+        {
+            queue.pop_min();
+        }
+
+        void pop_max()
+        {
+            queue.pop_max();
+        }
+
+        void replace_min(uint32_t val)
+        {
+            queue.replace_min(val);
+        }
+
+        size_t size() const
+        {
+            return queue.size();
+        }
+    };
+
+    template <typename Vector>
+    struct vector_adaptor
+    {
+        Vector queue;
+
+        void push(uint32_t val)
+        {
+            queue.emplace_binary(val);
+        }
+
+        uint32_t min()
+        {
+            return queue.min_element();
+        }
+
+        void pop_min()
+        {
+            queue.pop_front();
+        }
+
+        void pop_max()
+        {
+            queue.pop_back();
+        }
+
+        void replace_min(uint32_t val)
+        {
+            queue.replace_min(val);
+        }
+
+        size_t size() const
+        {
+            return queue.size();
+        }
+    };
+
+    double ns_per_op(std::chrono::high_resolution_clock::time_point begin, unsigned int ops)
+    {
+        auto end = std::chrono::high_resolution_clock::now();
+        return double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / ops;
+    }
+
+    // top-k: keep the Size largest keys of a stream, the smallest one gets replaced.
+    // mixed: random pushes and pops from both ends between empty and full.
+    template <typename Adaptor, size_t Size>
+    void run(const char *name)
+    {
+        constexpr unsigned int ops = 2000000;
+        static Adaptor adaptor;
+        uint32_t checksum = 0;
+
+        seed = 4711;
+        auto begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int i = 0; i < ops; ++i)
+        {
+            // slowly rising keys, so the set keeps changing
+            const uint32_t val = i * 4 + (myrand() >> 8) % (Size * 16);
+            if (adaptor.size() < Size)
+            {
+                adaptor.push(val);
+            }
+            else if (adaptor.min() < val)
+            {
+                adaptor.replace_min(val);
+            }
+        }
+        checksum += adaptor.min();
+        const double topk = ns_per_op(begin, ops);
+
+        begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int i = 0; i < ops; ++i)
+        {
+            const unsigned int r = myrand() >> 8;
+            if (adaptor.size() == Size || (adaptor.size() && (r & 1)))
+            {
+                if (r & 2)
+                {
+                    adaptor.pop_min();
+                }
+                else
+                {
+                    adaptor.pop_max();
+                }
+            }
+            else
+            {
+                adaptor.push(r);
+            }
+        }
+        const double mixed = ns_per_op(begin, ops);
+
+        while (adaptor.size())
+        {
+            checksum += adaptor.min();
+            adaptor.pop_min();
+        }
+
+        std::cout << "  " << name << " top-k: " << topk << "  mixed: " << mixed << "  (" << (checksum & 1) << ")\n";
+    }
+
+    template <size_t Size>
+    void benchmark()
+    {
+        std::cout << "Capacity " << Size << ", ns per operation:\n";
+        run<heap_adaptor<ulib::static_minmax_heap<uint32_t, Size>>, Size>("static_minmax_heap  ");
+        run<heap_adaptor<ulib::static_inverval_heap<uint32_t, Size>>, Size>("static_inverval_heap");
+        run<vector_adaptor<ulib::sorted_static_vector<uint32_t, Size>>, Size>("sorted_static_vector");
+    }
+
+} // namespace
+
+void static_minmax_heap_test()
+{
+    std::cout << "Min-max heap test:\n\n";
+
+    reference_test<ulib::static_minmax_heap<int, 3>>();
+    reference_test<ulib::static_minmax_heap<int, 7>>();
+    reference_test<ulib::static_minmax_heap<int, 100>>();
+    reference_test<ulib::static_inverval_heap<int, 3>>();
+    reference_test<ulib::static_inverval_heap<int, 7>>();
+    reference_test<ulib::static_inverval_heap<int, 100>>();
+
+    benchmark<16>();
+    benchmark<64>();
+    benchmark<256>();
+    benchmark<1024>();
+    benchmark<4096>();
+    std::cout << "\n";
+}
@@ -0,0 +1,130 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "static_mpmc_queue_test.hpp"
+#include "stdafx.h"
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <microlib/static_mpmc_queue.hpp>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using queue_type = ulib::static_mpmc_queue<unsigned int, 1024>;
+
+    void single_thread_test()
+    {
+        static ulib::static_mpmc_queue<unsigned int, 8> queue;
+        unsigned int values[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+        unsigned int out[10];
+
+        [[maybe_unused]] const size_t pushed = queue.try_push_n(values, 10);
+        assert(pushed == 8);
+        [[maybe_unused]] const bool overflowed = queue.try_push(8);
+        assert(!overflowed);
+        [[maybe_unused]] size_t popped = queue.try_pop_n(out, 3);
+        assert(popped == 3 && out[0] == 0 && out[2] == 2);
+        [[maybe_unused]] const bool pushed_again = queue.try_push(8);
+        assert(pushed_again);
+        popped = queue.try_pop_n(out, 10);
+        assert(popped == 6 && out[0] == 3 && out[5] == 8);
+        [[maybe_unused]] const bool underflowed = queue.try_pop(out[0]);
+        assert(!underflowed);
+    }
+
+    // Producers push batches of Batch, consumers pop batches of Batch, the sum must survive.
+    template <size_t Batch>
+    double run(queue_type &queue, unsigned int producers, unsigned int consumers, unsigned int items)
+    {
+        const unsigned int per_producer = items / producers;
+        const unsigned long long total = (unsigned long long)per_producer * producers;
+        std::atomic<unsigned long long> consumed(0);
+        std::atomic<unsigned long long> sum(0);
+        std::vector<std::thread> threads;
+
+        auto begin = std::chrono::high_resolution_clock::now();
+
+        for (unsigned int p = 0; p < producers; ++p)
+        {
+            threads.emplace_back([&queue, per_producer]() {
+                unsigned int values[Batch];
+                for (unsigned int i = 0; i < per_producer;)
+                {
+                    size_t n = 0;
+                    for (; n < Batch && i + n < per_producer; ++n)
+                    {
+                        values[n] = i + n;
+                    }
+
+                    const size_t pushed = queue.try_push_n(values, n);
+                    i += unsigned(pushed);
+                    if (!pushed)
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+
+        for (unsigned int c = 0; c < consumers; ++c)
+        {
+            threads.emplace_back([&queue, &consumed, &sum, total]() {
+                unsigned int values[Batch];
+                unsigned long long local_sum = 0;
+                while (consumed.load(std::memory_order_relaxed) < total)
+                {
+                    const size_t popped = queue.try_pop_n(values, Batch);
+                    for (size_t i = 0; i < popped; ++i)
+                    {
+                        local_sum += values[i];
+                    }
+                    if (popped)
+                    {
+                        consumed += popped;
+                    }
+                    else
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+                sum += local_sum;
+            });
+        }
+
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        auto end = std::chrono::high_resolution_clock::now();
+
+        assert(consumed == total);
+        assert(sum == (unsigned long long)producers * per_producer * (per_producer - 1) / 2);
+
+        return double(total) / std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+    }
+
+} // namespace
+
+void static_mpmc_queue_test()
+{
+    static queue_type queue;
+
+    std::cout << "MPMC queue test:\n\n";
+
+    single_thread_test();
+
+    for (unsigned int threads = 1; threads <= 16; threads *= 2)
+    {
+        std::cout << "Producers/consumers: " << threads << "/" << threads;
+        std::cout << " single ops/us: " << run<1>(queue, threads, threads, 1000000);
+        std::cout << " batch(16) ops/us: " << run<16>(queue, threads, threads, 1000000) << "\n";
+    }
+
+    std::cout << "\n";
+}
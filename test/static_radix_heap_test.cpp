@@ -0,0 +1,244 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "static_radix_heap_test.hpp"
+#include "stdafx.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <microlib/static_heap.hpp>
+#include <microlib/static_radix_heap.hpp>
+#include <vector>
+
+namespace
+{
+    unsigned int a = 1140671485;
+    unsigned int c = 12820163;
+    unsigned int seed = 123541236;
+
+    unsigned int myrand()
+    {
+        return seed = ((seed * a + c) & 0xFFFFFF);
+    }
+
+    // Random pushes at or above the last popped key and pops, against a sorted reference.
+    template <typename Key>
+    void monotone_test(Key max_delta)
+    {
+        static ulib::static_radix_heap<Key, 500> heap;
+        std::vector<Key> reference;
+        Key floor = 0;
+
+        for (unsigned int i = 0; i < 200000; ++i)
+        {
+            if (heap.size() == heap.capacity() || (heap.size() && (myrand() >> 8) % 2))
+            {
+                std::sort(reference.begin(), reference.end());
+                assert(heap.top_element() == reference.front());
+                assert(heap.last_key() == reference.front());
+                floor = reference.front();
+                reference.erase(reference.begin());
+                heap.pop();
+            }
+            else if (floor > Key(Key(-1) - max_delta))
+            {
+                // about to run out of keys, start over
+                heap.clear();
+                reference.clear();
+                floor = 0;
+            }
+            else
+            {
+                const Key key = Key(floor + Key((myrand() >> 8) % (uint64_t(max_delta) + 1)));
+                const bool pushed = heap.push(key);
+                assert(pushed);
+                (void)pushed;
+                reference.push_back(key);
+            }
+            assert(heap.size() == reference.size());
+        }
+
+        while (heap.size() < heap.capacity())
+        {
+            heap.push(floor);
+        }
+        const bool overflowed = heap.push(floor);
+        assert(!overflowed);
+        (void)overflowed;
+        heap.clear();
+        assert(heap.empty() && heap.last_key() == 0);
+        const bool pushed = heap.push(Key(0));
+        assert(pushed);
+        (void)pushed;
+        heap.pop();
+    }
+
+    //
+    // Dijkstra with small integer weights and lazy deletion, plus a timer queue in steady state:
+    // the radix heap against static_heap.
+
+    constexpr unsigned int nodes = 1 << 14;
+    constexpr unsigned int degree = 8;
+    constexpr uint32_t unreached = uint32_t(-1);
+
+    struct edge
+    {
+        uint32_t to;
+        uint32_t weight;
+    };
+
+    struct entry
+    {
+        uint32_t distance;
+        uint32_t node;
+    };
+
+    struct entry_less
+    {
+        bool operator()(const entry &lhs, const entry &rhs) const
+        {
+            return lhs.distance < rhs.distance;
+        }
+    };
+
+    struct entry_key
+    {
+        uint32_t operator()(const entry &e) const
+        {
+            return e.distance;
+        }
+    };
+
+    edge graph[nodes][degree];
+    uint32_t distance[nodes];
+
+    template <typename Heap>
+    void dijkstra()
+    {
+        static Heap heap;
+
+        for (unsigned int n = 0; n < nodes; ++n)
+        {
+            distance[n] = unreached;
+        }
+
+        distance[0] = 0;
+        heap.push(entry{0, 0});
+        while (heap.size())
+        {
+            const entry current = heap.top_element();
+            heap.pop();
+            if (current.distance != distance[current.node])
+            {
+                continue;
+            }
+
+            for (const edge &e : graph[current.node])
+            {
+                const uint32_t candidate = current.distance + e.weight;
+                if (candidate < distance[e.to])
+                {
+                    distance[e.to] = candidate;
+                    heap.push(entry{candidate, e.to});
+                }
+            }
+        }
+    }
+
+    template <typename Heap>
+    double measure_dijkstra(uint64_t &checksum)
+    {
+        constexpr unsigned int rounds = 20;
+        auto begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int round = 0; round < rounds; ++round)
+        {
+            dijkstra<Heap>();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        checksum = 0;
+        for (auto d : distance)
+        {
+            checksum += d;
+        }
+        return double(std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()) / rounds;
+    }
+
+    // pop the earliest timer, rearm it up to max_delta later
+    template <typename Heap>
+    double measure_timers(uint32_t max_delta, uint64_t &checksum)
+    {
+        constexpr unsigned int timers = 4096;
+        constexpr unsigned int steps = 4000000;
+        static Heap heap;
+        heap.clear();
+
+        seed = 4711;
+        for (unsigned int i = 0; i < timers; ++i)
+        {
+            heap.push(uint32_t(1 + (myrand() >> 8) % max_delta));
+        }
+
+        checksum = 0;
+        auto begin = std::chrono::high_resolution_clock::now();
+        for (unsigned int i = 0; i < steps; ++i)
+        {
+            const uint32_t now = heap.top_element();
+            heap.pop();
+            checksum += now;
+            heap.push(uint32_t(now + 1 + (myrand() >> 8) % max_delta));
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        return double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / steps;
+    }
+
+} // namespace
+
+void static_radix_heap_test()
+{
+    std::cout << "Radix heap test:\n\n";
+
+    monotone_test<uint16_t>(50);
+    monotone_test<uint32_t>(1000);
+    monotone_test<uint32_t>(0xFFFFFF);
+    monotone_test<uint64_t>(7);
+
+    for (auto &edges : graph)
+    {
+        for (auto &e : edges)
+        {
+            e = edge{(myrand() >> 8) % nodes, 1 + (myrand() >> 8) % 16};
+        }
+    }
+
+    uint64_t heap_checksum;
+    uint64_t heap4_checksum;
+    uint64_t radix_checksum;
+    const double heap = measure_dijkstra<ulib::static_heap<entry, nodes * degree, entry_less>>(heap_checksum);
+    const double heap4 = measure_dijkstra<ulib::static_heap<entry, nodes * degree, entry_less, 4>>(heap4_checksum);
+    const double radix = measure_dijkstra<ulib::static_radix_heap<entry, nodes * degree, entry_key>>(radix_checksum);
+    assert(heap_checksum == radix_checksum && heap4_checksum == radix_checksum);
+
+    std::cout << "Dijkstra, " << nodes << " nodes, " << nodes * degree << " edges, weights 1-16, us:\n";
+    std::cout << "  static_heap        " << heap << "\n";
+    std::cout << "  static_heap 4-ary  " << heap4 << "\n";
+    std::cout << "  static_radix_heap  " << radix << "\n";
+
+    for (uint32_t max_delta : {16u, 1000u, 1000000u})
+    {
+        uint64_t checksums[3];
+        const double timers_heap = measure_timers<ulib::static_heap<uint32_t, 4096>>(max_delta, checksums[0]);
+        const double timers_heap4 = measure_timers<ulib::static_heap<uint32_t, 4096, std::less<uint32_t>, 4>>(max_delta, checksums[1]);
+        const double timers_radix = measure_timers<ulib::static_radix_heap<uint32_t, 4096>>(max_delta, checksums[2]);
+        assert(checksums[0] == checksums[2] && checksums[1] == checksums[2]);
+
+        std::cout << "4096 timers, rearmed up to " << max_delta << " ahead, ns per pop+push: static_heap " << timers_heap << "  4-ary "
+                  << timers_heap4 << "  static_radix_heap " << timers_radix << "\n";
+    }
+    std::cout << "\n";
+}
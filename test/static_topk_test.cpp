@@ -0,0 +1,183 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "static_topk_test.hpp"
+#include "stdafx.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <microlib/static_interval_heap.hpp>
+#include <microlib/static_topk.hpp>
+#include <vector>
+
+namespace
+{
+    unsigned int a = 1140671485;
+    unsigned int c = 12820163;
+    unsigned int seed = 123541236;
+
+    unsigned int myrand()
+    {
+        return seed = ((seed * a + c) & 0xFFFFFF);
+    }
+
+    // full 32 bit keys out of two draws
+    uint32_t rand32()
+    {
+        return (myrand() << 8) ^ myrand();
+    }
+
+    // single offers, pointer batches (SIMD scan where available) and list batches against a full sort
+    template <typename T, size_t K, typename Compare>
+    void reference_test()
+    {
+        static ulib::static_topk<T, K, Compare> topk;
+        Compare compare;
+
+        for (unsigned int round = 0; round < 30; ++round)
+        {
+            std::vector<T> values((myrand() >> 8) % (4 * K + 100));
+            for (auto &val : values)
+            {
+                // narrow range for duplicates, signed and float keys go negative
+                val = T(int((myrand() >> 8) % 2000) - (std::is_unsigned<T>::value ? 0 : 1000));
+            }
+
+            topk.clear();
+            switch (round % 3)
+            {
+            case 0:
+                for (const T &val : values)
+                {
+                    topk.offer(val);
+                }
+                break;
+            case 1:
+                topk.offer(values.data(), values.data() + values.size());
+                break;
+            case 2:
+            {
+                std::list<T> list(values.begin(), values.end());
+                topk.offer(list.begin(), list.end());
+                break;
+            }
+            }
+
+            std::vector<T> expected = values;
+            std::sort(expected.begin(), expected.end(), [&](const T &lhs, const T &rhs) { return compare(rhs, lhs); });
+            expected.resize(std::min(expected.size(), K));
+            assert(topk.size() == expected.size());
+            assert(topk.full() == (expected.size() == K));
+            if (!expected.empty())
+            {
+                assert(topk.threshold() == expected.back());
+            }
+
+            std::vector<T> result(topk.size());
+            [[maybe_unused]] const auto last = topk.sorted(result.begin());
+            assert(last == result.end());
+            assert(result == expected);
+            assert(topk.empty());
+        }
+    }
+
+    constexpr size_t stream_size = 1 << 22;
+    constexpr unsigned int passes = 24;
+
+    double ns_per_op(std::chrono::high_resolution_clock::time_point begin, unsigned long long ops)
+    {
+        auto end = std::chrono::high_resolution_clock::now();
+        return double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / ops;
+    }
+
+    void report(const char *name, double ns, uint32_t check)
+    {
+        std::cout << "  " << name << ": " << ns << "ns per item, " << 1000.0 / ns << "M items/s (" << (check & 1) << ")\n";
+    }
+
+    // The K largest of 100M random 32 bit keys: the interval heap with manual checks (as before),
+    // single offer() calls and one batch offer() per block of the stream.
+    template <size_t K>
+    void benchmark(const std::vector<uint32_t> &stream)
+    {
+        std::cout << "Top " << K << " of " << stream_size * passes / 1000000 << "M keys:\n";
+
+        {
+            static ulib::static_inverval_heap<uint32_t, K> heap;
+            heap.clear();
+            auto begin = std::chrono::high_resolution_clock::now();
+            for (unsigned int pass = 0; pass < passes; ++pass)
+            {
+                for (uint32_t key : stream)
+                {
+                    if (heap.size() < K)
+                    {
+                        heap.push(key);
+                    }
+                    else if (heap.min_element() < key)
+                    {
+                        heap.replace_min(key);
+                    }
+                }
+            }
+            report("static_inverval_heap  ", ns_per_op(begin, stream_size * passes), heap.min_element());
+        }
+
+        {
+            static ulib::static_topk<uint32_t, K> topk;
+            topk.clear();
+            auto begin = std::chrono::high_resolution_clock::now();
+            for (unsigned int pass = 0; pass < passes; ++pass)
+            {
+                for (uint32_t key : stream)
+                {
+                    topk.offer(key);
+                }
+            }
+            report("static_topk offer()   ", ns_per_op(begin, stream_size * passes), topk.threshold());
+        }
+
+        {
+            static ulib::static_topk<uint32_t, K> topk;
+            topk.clear();
+            auto begin = std::chrono::high_resolution_clock::now();
+            for (unsigned int pass = 0; pass < passes; ++pass)
+            {
+                topk.offer(stream.data(), stream.data() + stream.size());
+            }
+            report("static_topk batch     ", ns_per_op(begin, stream_size * passes), topk.threshold());
+        }
+    }
+
+} // namespace
+
+void static_topk_test()
+{
+    std::cout << "Top-k test:\n\n";
+
+    reference_test<int, 1, std::less<int>>();
+    reference_test<int, 7, std::less<int>>();
+    reference_test<int, 100, std::greater<int>>();
+    reference_test<uint32_t, 33, std::less<uint32_t>>();
+    reference_test<uint32_t, 64, std::greater<>>();
+    reference_test<float, 50, std::less<float>>();
+    reference_test<float, 9, std::greater<float>>();
+    reference_test<double, 20, std::less<double>>();
+
+    // the same keys in every pass, only the first pass fills the top-k
+    std::vector<uint32_t> stream(stream_size);
+    for (auto &key : stream)
+    {
+        key = rand32();
+    }
+
+    benchmark<100>(stream);
+    benchmark<1000>(stream);
+    std::cout << "\n";
+}
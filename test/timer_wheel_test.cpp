@@ -0,0 +1,218 @@
+//          Copyright Michael Steinberg 2015
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "timer_wheel_test.hpp"
+#include "stdafx.h"
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <microlib/static_addressable_heap.hpp>
+#include <microlib/static_heap.hpp>
+#include <microlib/timer_wheel.hpp>
+
+namespace
+{
+    unsigned int a = 1140671485;
+    unsigned int c = 12820163;
+    unsigned int seed = 123541236;
+
+    unsigned int myrand()
+    {
+        return seed = ((seed * a + c) & 0xFFFFFF);
+    }
+
+    // A small wheel (3 levels of 8 buckets, 512 ticks of 10 units) with delays far beyond its range,
+    // so timers cascade and get parked. Every timer must fire exactly at the first tick not before its expiry.
+    void expiry_test()
+    {
+        constexpr unsigned int timers = 256;
+        constexpr uint64_t granularity = 10;
+        static ulib::timer_wheel<unsigned int, timers, granularity, 3, 3> wheel(12345);
+
+        decltype(wheel)::timer *handles[timers] = {};
+        [[maybe_unused]] uint64_t due[timers];
+        uint64_t now = wheel.now();
+
+        for (unsigned int step = 0; step < 20000; ++step)
+        {
+            const unsigned int id = (myrand() >> 8) % timers;
+            if (handles[id])
+            {
+                if (myrand() % 2)
+                {
+                    wheel.cancel(handles[id]);
+                    handles[id] = nullptr;
+                }
+            }
+            else
+            {
+                // some already due, most within range, some far beyond
+                const uint64_t expiry = now - 50 + (myrand() >> 8) % (myrand() % 8 ? 6000 : 60000);
+                handles[id] = wheel.arm(expiry, id);
+                assert(handles[id] && handles[id]->payload == id);
+                const uint64_t tick = (expiry + granularity - 1) / granularity;
+                due[id] = tick > now / granularity ? tick : now / granularity + 1;
+            }
+
+            now += (myrand() >> 8) % 40;
+            wheel.advance(now, [&](unsigned int fired) {
+                assert(handles[fired] && due[fired] * granularity == wheel.now());
+                handles[fired] = nullptr;
+            });
+
+            size_t pending = 0;
+            for (unsigned int i = 0; i < timers; ++i)
+            {
+                pending += handles[i] != nullptr;
+                assert(!handles[i] || due[i] > now / granularity);
+            }
+            assert(pending == wheel.size());
+        }
+    }
+
+    //
+    // Connection timeouts: every step re-arms the timeouts of some random connections (cancel + arm),
+    // the rest expire. Compares the wheel against static_heap, which cannot cancel and skips
+    // stale entries on pop instead, and static_addressable_heap, which erases cancelled timers.
+
+    constexpr unsigned int connections = 1 << 14;
+    constexpr unsigned int rearms_per_step = 8;
+    constexpr unsigned int steps = 1 << 17;
+    constexpr unsigned int max_timeout = 5000;
+
+    struct benchmark_result
+    {
+        double ns_per_step;
+        unsigned int fired;
+    };
+
+    unsigned int timeout()
+    {
+        return 100 + (myrand() >> 8) % (max_timeout - 100);
+    }
+
+    template <typename Step>
+    benchmark_result run(Step step)
+    {
+        seed = 42;
+        unsigned int fired = 0;
+        auto begin = std::chrono::high_resolution_clock::now();
+        for (uint64_t now = 1; now <= steps; ++now)
+        {
+            fired += step(now);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        return {double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / steps, fired};
+    }
+
+    benchmark_result wheel_benchmark()
+    {
+        using wheel_type = ulib::timer_wheel<unsigned int, connections>;
+        static wheel_type wheel;
+        static wheel_type::timer *handles[connections];
+
+        return run([](uint64_t now) {
+            for (unsigned int i = 0; i < rearms_per_step; ++i)
+            {
+                const unsigned int conn = (myrand() >> 8) % connections;
+                if (handles[conn])
+                {
+                    wheel.cancel(handles[conn]);
+                }
+                handles[conn] = wheel.arm(now + timeout(), conn);
+            }
+            return unsigned(wheel.advance(now, [](unsigned int conn) { handles[conn] = nullptr; }));
+        });
+    }
+
+    struct heap_timer
+    {
+        uint64_t expiry;
+        unsigned int conn;
+        unsigned int generation;
+    };
+
+    struct heap_timer_less
+    {
+        bool operator()(const heap_timer &lhs, const heap_timer &rhs) const
+        {
+            return lhs.expiry < rhs.expiry;
+        }
+    };
+
+    benchmark_result heap_benchmark()
+    {
+        static ulib::static_heap<heap_timer, rearms_per_step * max_timeout, heap_timer_less> heap;
+        static unsigned int generation[connections];
+
+        return run([](uint64_t now) {
+            for (unsigned int i = 0; i < rearms_per_step; ++i)
+            {
+                const unsigned int conn = (myrand() >> 8) % connections;
+                heap.push(heap_timer{now + timeout(), conn, ++generation[conn]});
+            }
+
+            unsigned int fired = 0;
+            while (heap.size() && heap.top_element().expiry <= now)
+            {
+                fired += heap.top_element().generation == generation[heap.top_element().conn];
+                heap.pop();
+            }
+            return fired;
+        });
+    }
+
+    benchmark_result addressable_heap_benchmark()
+    {
+        using heap_type = ulib::static_addressable_heap<heap_timer, connections, heap_timer_less, 4>;
+        static heap_type heap;
+        static heap_type::handle handles[connections];
+        for (auto &h : handles)
+        {
+            h = heap_type::invalid_handle;
+        }
+
+        return run([](uint64_t now) {
+            for (unsigned int i = 0; i < rearms_per_step; ++i)
+            {
+                const unsigned int conn = (myrand() >> 8) % connections;
+                if (handles[conn] != heap_type::invalid_handle)
+                {
+                    heap.erase(handles[conn]);
+                }
+                handles[conn] = heap.push(heap_timer{now + timeout(), conn, 0});
+            }
+
+            unsigned int fired = 0;
+            while (heap.size() && heap.top_element().expiry <= now)
+            {
+                handles[heap.top_element().conn] = heap_type::invalid_handle;
+                heap.pop();
+                ++fired;
+            }
+            return fired;
+        });
+    }
+
+} // namespace
+
+void timer_wheel_test()
+{
+    std::cout << "Timer wheel test:\n\n";
+
+    expiry_test();
+
+    const benchmark_result wheel = wheel_benchmark();
+    const benchmark_result heap = heap_benchmark();
+    const benchmark_result addressable = addressable_heap_benchmark();
+    assert(wheel.fired == heap.fired && wheel.fired == addressable.fired);
+
+    std::cout << connections << " connections, " << rearms_per_step << " re-arms per tick, " << wheel.fired << " of "
+              << steps * rearms_per_step << " timers fired\n";
+    std::cout << "timer_wheel ns/tick:             " << wheel.ns_per_step << "\n";
+    std::cout << "static_heap ns/tick:             " << heap.ns_per_step << "\n";
+    std::cout << "static_addressable_heap ns/tick: " << addressable.ns_per_step << "\n\n";
+}